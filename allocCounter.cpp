@@ -0,0 +1,35 @@
+#include "allocCounter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+std::atomic<std::size_t> alloc_count(0);
+}
+
+std::size_t allocationCount()
+{
+	return alloc_count.load(std::memory_order_relaxed);
+}
+
+// the array and nothrow forms call these
+void* operator new(std::size_t size)
+{
+	alloc_count.fetch_add(1, std::memory_order_relaxed);
+
+	void *p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstddef>
+
+/// number of calls to global operator new since the program started
+/// (the arenas allocate through operator new, so they are counted too)
+std::size_t allocationCount();
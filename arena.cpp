@@ -0,0 +1,109 @@
+#include "arena.hpp"
+#include <cstdint>
+#include <cstring>
+
+Arena::Arena(std::size_t block_size)
+: block_size_(block_size)
+{
+	newBlock(block_size_);
+}
+
+Arena::~Arena()
+{
+	runFinalizers();
+	freeBlocks();
+}
+
+void* Arena::allocate(std::size_t size, std::size_t align)
+{
+	std::uintptr_t p = reinterpret_cast<std::uintptr_t>(cur_);
+	p = (p + align - 1) & ~std::uintptr_t(align - 1);
+
+	if (p + size > reinterpret_cast<std::uintptr_t>(end_))
+	{
+		newBlock(size + align);
+
+		p = reinterpret_cast<std::uintptr_t>(cur_);
+		p = (p + align - 1) & ~std::uintptr_t(align - 1);
+	}
+
+	cur_ = reinterpret_cast<char*>(p + size);
+	return reinterpret_cast<void*>(p);
+}
+
+const char* Arena::copyString(const char *str)
+{
+	const std::size_t len = std::strlen(str);
+	char *ret = static_cast<char*>(allocate(len + 1, 1));
+	std::memcpy(ret, str, len + 1);
+	return ret;
+}
+
+void Arena::reset()
+{
+	runFinalizers();
+
+	// merge everything into one block, so the next round does not grow
+	if (head_->next)
+	{
+		const std::size_t total = capacity();
+		freeBlocks();
+		newBlock(total);
+	}
+
+	cur_ = blockData(head_);
+	retired_bytes_ = 0;
+}
+
+std::size_t Arena::capacity() const
+{
+	std::size_t total = 0;
+	for (Block *b = head_; b; b = b->next)
+		total += b->size;
+	return total;
+}
+
+void Arena::addFinalizer(void (*fn)(void*), void *obj)
+{
+	Finalizer *f = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+	f->fn = fn;
+	f->obj = obj;
+	f->next = finalizers_;
+	finalizers_ = f;
+}
+
+void Arena::runFinalizers()
+{
+	// newest first
+	for (Finalizer *f = finalizers_; f; f = f->next)
+		f->fn(f->obj);
+	finalizers_ = nullptr;
+}
+
+void Arena::newBlock(std::size_t min_size)
+{
+	const std::size_t size = min_size > block_size_ ? min_size : block_size_;
+
+	// operator new (rather than malloc), so the allocation counter sees it
+	Block *b = static_cast<Block*>(::operator new(sizeof(Block) + size));
+	b->next = head_;
+	b->size = size;
+
+	if (head_)
+		retired_bytes_ += cur_ - blockData(head_);
+
+	head_ = b;
+	cur_ = blockData(b);
+	end_ = cur_ + size;
+}
+
+void Arena::freeBlocks()
+{
+	while (head_)
+	{
+		Block *next = head_->next;
+		::operator delete(head_);
+		head_ = next;
+	}
+	cur_ = end_ = nullptr;
+}
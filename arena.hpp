@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// Linear (bump pointer) allocator.
+/// Memory comes from large blocks and is only given back all at once, by
+/// reset() or the destructor. Used with scene lifetime (nodes, meshes, names)
+/// and with frame lifetime (visible lists, draw packets).
+class Arena
+{
+public:
+	/// block_size is the size of the first block (and the minimum of any other)
+	explicit Arena(std::size_t block_size = 64 * 1024);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/// raw memory, valid until the next reset
+	void* allocate(std::size_t size, std::size_t align = alignof(std::max_align_t));
+
+	/// construct an object in the arena
+	/// its destructor is run by reset (newest object first)
+	template<typename T, typename... Args>
+	T* create(Args&&... args)
+	{
+		void *mem = allocate(sizeof(T), alignof(T));
+		T *obj = new (mem) T(std::forward<Args>(args)...);
+		if (!std::is_trivially_destructible<T>::value)
+			addFinalizer(&destroy<T>, obj);
+		return obj;
+	}
+
+	/// value initialized array of plain data
+	template<typename T>
+	T* allocArray(std::size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "arena arrays are not destroyed");
+		if (count == 0)
+			return nullptr;
+
+		T *ary = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+		for (std::size_t i = 0; i < count; ++i)
+			new (&ary[i]) T();
+		return ary;
+	}
+
+	/// copy of a NUL terminated string
+	const char* copyString(const char *str);
+
+	/// destroy all created objects and make all memory available again
+	/// if the arena had to grow, the blocks are merged into one, so a steady
+	/// state of use does not touch the heap
+	void reset();
+
+	/// bytes handed out since the last reset
+	std::size_t bytesUsed() const { return retired_bytes_ + (cur_ - blockData(head_)); }
+
+	/// bytes held from the heap
+	std::size_t capacity() const;
+
+private: // types
+	/// header in front of every block of memory
+	struct Block
+	{
+		Block *next; ///< older block
+		std::size_t size; ///< usable bytes after the header
+	};
+
+	/// how to destroy one object from create()
+	struct Finalizer
+	{
+		void (*fn)(void*);
+		void *obj;
+		Finalizer *next; ///< older finalizer
+	};
+
+private: // methods
+	template<typename T>
+	static void destroy(void *obj)
+	{
+		static_cast<T*>(obj)->~T();
+	}
+
+	static char* blockData(Block *b) { return reinterpret_cast<char*>(b + 1); }
+
+	void addFinalizer(void (*fn)(void*), void *obj);
+	void runFinalizers();
+	void newBlock(std::size_t min_size);
+	void freeBlocks();
+
+private: // data
+	std::size_t block_size_; ///< minimum size of new blocks
+	Block *head_ = nullptr; ///< block being filled
+	char *cur_ = nullptr; ///< next free byte in head_
+	char *end_ = nullptr; ///< end of head_
+	std::size_t retired_bytes_ = 0; ///< bytes used in older blocks
+	Finalizer *finalizers_ = nullptr; ///< newest first
+};
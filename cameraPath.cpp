@@ -0,0 +1,102 @@
+#include "cameraPath.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+
+/// camera path header
+struct PathHeader
+{
+	char magic[4]; ///< "YYCP"
+	std::uint32_t version;
+	std::uint32_t num_keys;
+	std::uint32_t key_size; ///< sizeof(CameraKey)
+};
+
+const std::uint32_t PATH_VERSION = 1;
+
+}
+
+bool writeCameraPath(const char *path, const std::vector<CameraKey> &keys)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file)
+	{
+		std::cerr << path << " could not be opened for writing." << std::endl;
+		return false;
+	}
+
+	PathHeader hdr;
+	std::memcpy(hdr.magic, "YYCP", 4);
+	hdr.version = PATH_VERSION;
+	hdr.num_keys = keys.size();
+	hdr.key_size = sizeof(CameraKey);
+
+	const bool ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1
+	    && (keys.empty() || fwrite(&keys[0], sizeof(CameraKey), keys.size(), file) == keys.size());
+
+	fclose(file);
+	if (!ok)
+	{
+		std::cerr << "Failed writing " << path << std::endl;
+		std::remove(path);
+	}
+	return ok;
+}
+
+bool readCameraPath(const char *path, std::vector<CameraKey> &keys)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file)
+	{
+		std::cerr << path << " could not be opened." << std::endl;
+		return false;
+	}
+
+	PathHeader hdr;
+	if (fread(&hdr, sizeof(hdr), 1, file) != 1 ||
+	    std::memcmp(hdr.magic, "YYCP", 4) != 0 ||
+	    hdr.version != PATH_VERSION ||
+	    hdr.key_size != sizeof(CameraKey))
+	{
+		std::cerr << path << " is not a camera path file." << std::endl;
+		fclose(file);
+		return false;
+	}
+
+	keys.resize(hdr.num_keys);
+	const bool ok = hdr.num_keys != 0
+	    && fread(&keys[0], sizeof(CameraKey), keys.size(), file) == keys.size();
+
+	fclose(file);
+	if (!ok)
+		std::cerr << path << " is truncated or empty." << std::endl;
+	return ok;
+}
+
+CameraKey sampleCameraPath(const std::vector<CameraKey> &keys, float t)
+{
+	// first key after t
+	const auto next = std::upper_bound(keys.begin(), keys.end(), t,
+	    [](float time, const CameraKey &k) { return time < k.time; });
+	if (next == keys.begin())
+		return keys.front();
+	if (next == keys.end())
+		return keys.back();
+
+	const CameraKey &a = *(next - 1);
+	const CameraKey &b = *next;
+	const float f = b.time > a.time ? (t - a.time) / (b.time - a.time) : 1.f;
+
+	CameraKey k;
+	k.time = t;
+	k.position = glm::mix(a.position, b.position, f);
+	k.horizontal_angle = glm::mix(a.horizontal_angle, b.horizontal_angle, f);
+	k.vertical_angle = glm::mix(a.vertical_angle, b.vertical_angle, f);
+	k.fov = glm::mix(a.fov, b.fov, f);
+	return k;
+}
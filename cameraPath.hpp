@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+/// Camera state at one moment of a recording
+struct CameraKey
+{
+	float time; ///< seconds since the start of the recording
+	glm::vec3 position;
+	float horizontal_angle;
+	float vertical_angle;
+	float fov; ///< degrees
+};
+
+/// binary camera path file (header, then the keys in time order)
+bool writeCameraPath(const char *path, const std::vector<CameraKey> &keys);
+bool readCameraPath(const char *path, std::vector<CameraKey> &keys);
+
+/// camera at time t (keys must not be empty), linear between keys
+CameraKey sampleCameraPath(const std::vector<CameraKey> &keys, float t);
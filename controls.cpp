@@ -2,20 +2,94 @@
 
 // Include GLM
 #include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
 
 Controls::Controls(GLFWwindow *window)
 : window_(window)
 {
+	updateDirections();
 }
 
-void Controls::computeMatricesFromInputs()
+void Controls::startRecording()
+{
+	recording_ = true;
+	record_time_ = 0;
+	last_time_ = -1; // the first key is at time 0
+	record_.clear();
+	// an hour at 60 fps, so recording doesn't disturb what it records
+	record_.reserve(60 * 60 * 60);
+}
+
+bool Controls::stopRecording(const char *path)
 {
-	// store last call time
-	static double last_time = glfwGetTime();
+	recording_ = false;
+	const bool ok = writeCameraPath(path, record_);
+	record_ = std::vector<CameraKey>();
+	return ok;
+}
+
+bool Controls::startReplay(const char *path, float timestep)
+{
+	stopReplay();
+	if (timestep <= 0)
+	{
+		std::cerr << "Replay timestep must be positive" << std::endl;
+		return false;
+	}
+	if (!readCameraPath(path, replay_))
+	{
+		replay_.clear();
+		return false;
+	}
+
+	replay_time_ = replay_.front().time;
+	replay_step_ = timestep;
+	return true;
+}
+
+void Controls::stopReplay()
+{
+	replay_.clear();
+}
+
+bool Controls::replayDone() const
+{
+	return replaying() && replay_time_ > replay_.back().time;
+}
 
+unsigned Controls::replayFrames() const
+{
+	if (!replaying() || replay_step_ <= 0)
+		return 0;
+	return unsigned((replay_.back().time - replay_.front().time) / replay_step_) + 1;
+}
+
+void Controls::computeMatricesFromInputs()
+{
 	// compute time difference between current and last frame
 	const double current_time = glfwGetTime();
-	const float delta_time = current_time - last_time; // only float used in calculations
+	// the first frame doesn't move (loading happens after the constructor)
+	if (last_time_ < 0)
+		last_time_ = current_time;
+	const float delta_time = current_time - last_time_; // only float used in calculations
+
+	// for the next frame, the "last time" will be "now"
+	last_time_ = current_time;
+
+	if (replaying())
+	{
+		// fixed steps, not the wall clock
+		const CameraKey k = sampleCameraPath(replay_, replay_time_);
+		replay_time_ += replay_step_;
+
+		position_ = k.position;
+		horizontal_angle_ = k.horizontal_angle;
+		vertical_angle_ = k.vertical_angle;
+		initial_fov_ = k.fov;
+		updateDirections();
+		updateMatrices();
+		return;
+	}
 
 	// get mouse position
 	double xpos = 0, ypos = 0;
@@ -27,51 +101,70 @@ void Controls::computeMatricesFromInputs()
 	// compute new orientation
 	horizontal_angle_ += MOUSE_SPEED * float(1024/2 - xpos);
 	vertical_angle_   += MOUSE_SPEED * float( 768/2 - ypos);
+	updateDirections();
 
+	// move forward
+	if (glfwGetKey(window_, GLFW_KEY_UP   ) == GLFW_PRESS) {position_ += direction_ * delta_time * SPEED;}
+	// move backward
+	if (glfwGetKey(window_, GLFW_KEY_DOWN ) == GLFW_PRESS) {position_ -= direction_ * delta_time * SPEED;}
+	// strafe right
+	if (glfwGetKey(window_, GLFW_KEY_RIGHT) == GLFW_PRESS) { position_ += right_ * delta_time * SPEED; }
+	// strafe left
+	if (glfwGetKey(window_, GLFW_KEY_LEFT ) == GLFW_PRESS) { position_ -= right_ * delta_time * SPEED; }
+	// fly up
+	if (glfwGetKey(window_, GLFW_KEY_PAGE_UP) == GLFW_PRESS) { position_[1] += delta_time * SPEED; }
+	// fly down
+	if (glfwGetKey(window_, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS) { position_[1] -= delta_time * SPEED; }
+
+	// - 5 * glfwGetMouseWheel();
+	// Now GLFW 3 requires setting up a callback for this. It's a bit too complicated for this beginner's tutorial, so it's disabled instead.
+
+	updateMatrices();
+
+	if (recording_)
+	{
+		record_time_ += delta_time;
+
+		CameraKey k;
+		k.time = record_time_;
+		k.position = position_;
+		k.horizontal_angle = horizontal_angle_;
+		k.vertical_angle = vertical_angle_;
+		k.fov = initial_fov_;
+		record_.push_back(k);
+	}
+}
+
+void Controls::updateDirections()
+{
 	// direction: Spherical coordinates to Cartesian coordinates conversion
-	glm::vec3 direction(
+	direction_ = glm::vec3(
 	    cosf(vertical_angle_) * sinf(horizontal_angle_),
 	    sinf(vertical_angle_),
 	    cosf(vertical_angle_) * cosf(horizontal_angle_)
 	);
 
 	// right vector
-	glm::vec3 right = glm::vec3(
+	right_ = glm::vec3(
 		sinf(horizontal_angle_ - 3.14f/2.0f),
 		0,
 		cosf(horizontal_angle_ - 3.14f/2.0f)
 	);
+}
 
+void Controls::updateMatrices()
+{
 	// up vector
-	glm::vec3 up = glm::cross(right, direction);
+	glm::vec3 up = glm::cross(right_, direction_);
 
-	// move forward
-	if (glfwGetKey(window_, GLFW_KEY_UP   ) == GLFW_PRESS) {position_ += direction * delta_time * SPEED;}
-	// move backward
-	if (glfwGetKey(window_, GLFW_KEY_DOWN ) == GLFW_PRESS) {position_ -= direction * delta_time * SPEED;}
-	// strafe right
-	if (glfwGetKey(window_, GLFW_KEY_RIGHT) == GLFW_PRESS) { position_ += right * delta_time * SPEED; }
-	// strafe left
-	if (glfwGetKey(window_, GLFW_KEY_LEFT ) == GLFW_PRESS) { position_ -= right * delta_time * SPEED; }
-	// fly up
-	if (glfwGetKey(window_, GLFW_KEY_PAGE_UP) == GLFW_PRESS) { position_[1] += delta_time * SPEED; }
-	// fly down
-	if (glfwGetKey(window_, GLFW_KEY_PAGE_DOWN) == GLFW_PRESS) { position_[1] -= delta_time * SPEED; }
-
-	// - 5 * glfwGetMouseWheel();
-	// Now GLFW 3 requires setting up a callback for this. It's a bit too complicated for this beginner's tutorial, so it's disabled instead.
 	float fov = initial_fov_;
 
 	// projection matrix: 45 deg Field of View, 4:3 ratio, display range : 0.1 unit <-> 100 units
-	projection_matrix_ = glm::perspective(glm::radians(fov), 4.0f / 3.0f, 0.1f, 100.0f);
+	projection_matrix_ = glm::perspective(glm::radians(fov), ASPECT_RATIO, NEAR_PLANE, FAR_PLANE);
 	// camera matrix
 	view_matrix_       = glm::lookAt(
 	                     position_,           // Camera is here
-	                     position_+direction, // and looks here : at the same position, plus "direction"
+	                     position_+direction_, // and looks here : at the same position, plus "direction"
 	                     up                   // Head is up (set to 0,-1,0 to look upside-down)
 	                  );
-
-	// for the next frame, the "last time" will be "now"
-	last_time = current_time;
 }
-
@@ -1,19 +1,52 @@
 #pragma once
 
+#include "cameraPath.hpp"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
+#include <vector>
 
 class Controls
 {
 public:
+	// projection
+	static constexpr float ASPECT_RATIO = 4.0f / 3.0f;
+	static constexpr float NEAR_PLANE = 0.1f;
+	static constexpr float FAR_PLANE = 100.0f;
+
 	/// constructor
 	explicit Controls(GLFWwindow *window);
 
 	glm::mat4 viewMatrix() const { return view_matrix_; }
 	glm::mat4 projectionMatrix() const { return projection_matrix_; }
 
+	/// vertical, in degrees
+	float fieldOfView() const { return initial_fov_; }
+
+	/// from input, or the replay (which ignores input)
 	void computeMatricesFromInputs();
 
+	/// keep the camera of every frame, until stopRecording
+	void startRecording();
+	/// write what was recorded
+	bool stopRecording(const char *path);
+	bool recording() const { return recording_; }
+
+	/// drive the camera from a recording, moving timestep seconds every frame
+	/// (the same frames every run, however long they take)
+	bool startReplay(const char *path, float timestep);
+	void stopReplay();
+	bool replaying() const { return !replay_.empty(); }
+	/// the replay is past its last key
+	bool replayDone() const;
+	/// frames in the whole replay
+	unsigned replayFrames() const;
+
+private:
+	/// direction_ and right_ from the current angles
+	void updateDirections();
+	/// matrices from the current position and directions
+	void updateMatrices();
+
 private:
 	static constexpr float SPEED = 3.0f; // 3 units / second
 	static constexpr float MOUSE_SPEED = 0.005f;
@@ -22,9 +55,21 @@ private:
 	float horizontal_angle_ = 3.14f; ///< horizontal angle : toward -Z
 	float   vertical_angle_ = 0.00f; ///< vertical angle : none
 	float initial_fov_ = 45.0f; ///< Field of View
+	glm::vec3 direction_; ///< looking this way (from the angles)
+	glm::vec3 right_; ///< strafing this way (from the angles)
 
 	GLFWwindow *window_; ///< window we control
+	double last_time_ = -1; ///< of the last computeMatricesFromInputs (< 0 before the first)
 	glm::mat4 view_matrix_; ///< second part of MVP
 	glm::mat4 projection_matrix_; ///< first part of MVP
-};
 
+	// recording
+	bool recording_ = false;
+	float record_time_ = 0; ///< seconds since startRecording
+	std::vector<CameraKey> record_;
+
+	// replay
+	std::vector<CameraKey> replay_; ///< empty when not replaying
+	float replay_time_ = 0;
+	float replay_step_ = 0; ///< seconds per frame
+};
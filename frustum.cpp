@@ -0,0 +1,76 @@
+#include "frustum.hpp"
+#include <cmath>
+
+Frustum extractFrustum(const glm::mat4 &vp)
+{
+	// rows of the (column major) matrix
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; ++i)
+		row[i] = glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]);
+
+	Frustum f;
+	f.planes[0] = row[3] + row[0]; // left
+	f.planes[1] = row[3] - row[0]; // right
+	f.planes[2] = row[3] + row[1]; // bottom
+	f.planes[3] = row[3] - row[1]; // top
+	f.planes[4] = row[3] + row[2]; // near
+	f.planes[5] = row[3] - row[2]; // far
+
+	for (auto &p : f.planes)
+		p /= glm::length(glm::vec3(p));
+
+	return f;
+}
+
+bool isBoxVisible(const Frustum &f, const glm::mat4 &model,
+    const glm::vec3 &box_min, const glm::vec3 &box_max)
+{
+	// world space box, as center and half extent
+	const glm::vec3 local_center = (box_min + box_max) * 0.5f;
+	const glm::vec3 local_extent = (box_max - box_min) * 0.5f;
+
+	const glm::vec3 center = glm::vec3(model * glm::vec4(local_center, 1.f));
+	glm::vec3 extent;
+	for (int i = 0; i < 3; ++i)
+	{
+		extent[i] = std::abs(model[0][i]) * local_extent.x
+		    + std::abs(model[1][i]) * local_extent.y
+		    + std::abs(model[2][i]) * local_extent.z;
+	}
+
+	for (const auto &p : f.planes)
+	{
+		const glm::vec3 n(p);
+		const float radius = glm::dot(glm::abs(n), extent);
+		if (glm::dot(n, center) + p.w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool isSphereVisible(const Frustum &f, const glm::vec3 &center, float radius)
+{
+	for (const auto &p : f.planes)
+	{
+		if (glm::dot(glm::vec3(p), center) + p.w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+Frustum transformFrustum(const Frustum &f, const glm::mat4 &model)
+{
+	// planes are rows, so they go through the transpose
+	const glm::mat4 t = glm::transpose(model);
+
+	Frustum local;
+	for (int i = 0; i < 6; ++i)
+	{
+		local.planes[i] = t * f.planes[i];
+		local.planes[i] /= glm::length(glm::vec3(local.planes[i]));
+	}
+
+	return local;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/// view frustum as six planes (xyz normal points inside, w distance)
+struct Frustum
+{
+	glm::vec4 planes[6];
+};
+
+/// planes from a view projection matrix (world space)
+Frustum extractFrustum(const glm::mat4 &vp);
+
+/// is the model space box (placed by model) at least partly inside
+bool isBoxVisible(const Frustum &f, const glm::mat4 &model,
+    const glm::vec3 &box_min, const glm::vec3 &box_max);
+
+/// is the sphere at least partly inside
+bool isSphereVisible(const Frustum &f, const glm::vec3 &center, float radius);
+
+/// the frustum in the space model maps to world (for tests in model space)
+Frustum transformFrustum(const Frustum &f, const glm::mat4 &model);
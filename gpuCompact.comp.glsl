@@ -0,0 +1,79 @@
+#version 430 core
+
+// write an indirect draw for every visible cluster instance, packed together
+// (same group size as the cull pass, so the groups line up)
+layout(local_size_x = 256) in;
+
+const uint INVISIBLE = 0xffffffffu;
+
+struct InstanceData
+{
+	uint node;
+	uint mesh;
+	uint cluster;
+	uint pad;
+};
+
+struct MeshDesc
+{
+	vec4 bounds_min;
+	vec4 bounds_max;
+	uint base_vertex;
+	uint num_lods;
+	uint first_cluster;
+	uint num_clusters;
+	uvec4 lod_first;
+	uvec4 lod_count;
+	vec4 lod_distance;
+};
+
+struct ClusterData
+{
+	vec4 sphere; // center, radius (model space)
+	vec4 cone; // axis, cutoff (> 1 for no cone)
+	uint first_index;
+	uint num_indices;
+	uint lod;
+	uint pad;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instance_count;
+	uint first_index;
+	int base_vertex;
+	uint base_instance;
+};
+
+layout(std430, binding = 2) readonly buffer Instances { InstanceData instances[]; };
+layout(std430, binding = 3) readonly buffer Meshes { MeshDesc meshes[]; };
+layout(std430, binding = 4) readonly buffer Visibility { uvec2 visibility[]; };
+layout(std430, binding = 5) readonly buffer Blocks { uint block_offsets[]; };
+layout(std430, binding = 6) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 8) readonly buffer Clusters { ClusterData clusters[]; };
+
+uniform uint num_instances;
+
+void main()
+{
+	uint id = gl_GlobalInvocationID.x;
+	if (id >= num_instances)
+		return;
+
+	uvec2 vis = visibility[id];
+	if (vis.y == INVISIBLE)
+		return;
+
+	InstanceData inst = instances[id];
+	MeshDesc desc = meshes[inst.mesh];
+	ClusterData cluster = clusters[inst.cluster];
+
+	uint dst = block_offsets[gl_WorkGroupID.x] + vis.x;
+	commands[dst].count = cluster.num_indices;
+	commands[dst].instance_count = 1u;
+	commands[dst].first_index = cluster.first_index;
+	commands[dst].base_vertex = int(desc.base_vertex);
+	// the vertex shader finds the instance through this
+	commands[dst].base_instance = id;
+}
@@ -0,0 +1,149 @@
+#version 430 core
+
+// frustum test and LOD pick of every instance, for each of its clusters
+// then frustum and normal cone test of the meshlets (clusters of LOD 0)
+// then count the visible ones in each group (exclusive scan in the group)
+layout(local_size_x = 256) in;
+
+const uint INVISIBLE = 0xffffffffu;
+
+struct InstanceData
+{
+	uint node;
+	uint mesh;
+	uint cluster;
+	uint pad;
+};
+
+struct MeshDesc
+{
+	vec4 bounds_min; // model space
+	vec4 bounds_max;
+	uint base_vertex;
+	uint num_lods;
+	uint first_cluster;
+	uint num_clusters;
+	uvec4 lod_first;
+	uvec4 lod_count;
+	vec4 lod_distance; // use the next LOD beyond this
+};
+
+struct ClusterData
+{
+	vec4 sphere; // center, radius (model space)
+	vec4 cone; // axis, cutoff (> 1 for no cone)
+	uint first_index;
+	uint num_indices;
+	uint lod;
+	uint pad;
+};
+
+layout(std430, binding = 1) readonly buffer World { mat4 world[]; };
+layout(std430, binding = 2) readonly buffer Instances { InstanceData instances[]; };
+layout(std430, binding = 3) readonly buffer Meshes { MeshDesc meshes[]; };
+layout(std430, binding = 4) writeonly buffer Visibility { uvec2 visibility[]; }; // offset in group, LOD
+layout(std430, binding = 5) writeonly buffer Blocks { uint block_sums[]; };
+layout(std430, binding = 8) readonly buffer Clusters { ClusterData clusters[]; };
+
+uniform vec4 frustum_planes[6]; // world space, normals point in
+uniform vec3 camera_position; // picks the LOD
+uniform vec4 view_origin; // camera position (w = 1), or orthographic view direction (w = 0)
+uniform uint num_instances;
+
+shared uint scan[256];
+
+// does every triangle of the cluster face away from the view
+// (all in model space, like isMeshletBackfacing)
+bool backfacing(ClusterData cluster, vec4 view)
+{
+	vec3 axis = cluster.cone.xyz;
+	float cutoff = cluster.cone.w;
+	if (view.w == 0.0)
+		return dot(view.xyz, axis) >= cutoff;
+
+	vec3 d = cluster.sphere.xyz - view.xyz;
+	return dot(d, axis) >= cutoff * length(d) + cluster.sphere.w * (1.0 + cutoff);
+}
+
+void main()
+{
+	uint id = gl_GlobalInvocationID.x;
+	uint lid = gl_LocalInvocationID.x;
+
+	uint visible = 0u;
+	uint lod = 0u;
+	if (id < num_instances)
+	{
+		InstanceData inst = instances[id];
+		MeshDesc desc = meshes[inst.mesh];
+		mat4 m = world[inst.node];
+
+		// world space box, as center and half extent
+		vec3 local_center = (desc.bounds_min.xyz + desc.bounds_max.xyz) * 0.5;
+		vec3 local_extent = (desc.bounds_max.xyz - desc.bounds_min.xyz) * 0.5;
+		vec3 center = (m * vec4(local_center, 1)).xyz;
+		vec3 extent = mat3(abs(m[0].xyz), abs(m[1].xyz), abs(m[2].xyz)) * local_extent;
+
+		visible = 1u;
+		for (int i = 0; i < 6; ++i)
+		{
+			vec4 p = frustum_planes[i];
+			float radius = dot(abs(p.xyz), extent);
+			if (dot(p.xyz, center) + p.w < -radius)
+				visible = 0u;
+		}
+
+		float d = distance(camera_position, center);
+		while (lod + 1u < desc.num_lods && d > desc.lod_distance[lod])
+			++lod;
+
+		// only the clusters of the chosen LOD draw
+		ClusterData cluster = clusters[inst.cluster];
+		if (cluster.lod != lod)
+			visible = 0u;
+
+		// bounding sphere and normal cone (no cone can't be culled)
+		if (visible != 0u)
+		{
+			// largest scale, so the sphere still holds the cluster
+			float scale = max(length(m[0].xyz), max(length(m[1].xyz), length(m[2].xyz)));
+			vec3 sphere_center = (m * vec4(cluster.sphere.xyz, 1)).xyz;
+			float sphere_radius = cluster.sphere.w * scale;
+
+			for (int i = 0; i < 6; ++i)
+			{
+				vec4 p = frustum_planes[i];
+				if (dot(p.xyz, sphere_center) + p.w < -sphere_radius)
+					visible = 0u;
+			}
+
+			// the view goes to model space instead of the cone, which is exact
+			// under any scale (a cutoff > 1 has no cone, skip the inverse)
+			if (visible != 0u && cluster.cone.w <= 1.0)
+			{
+				vec4 view = inverse(m) * view_origin;
+				if (view_origin.w == 0.0)
+					view = vec4(normalize(view.xyz), 0.0);
+				if (backfacing(cluster, view))
+					visible = 0u;
+			}
+		}
+	}
+
+	// inclusive scan of the visible flags
+	scan[lid] = visible;
+	barrier();
+	for (uint offset = 1u; offset < 256u; offset <<= 1u)
+	{
+		uint v = lid >= offset ? scan[lid - offset] : 0u;
+		barrier();
+		scan[lid] += v;
+		barrier();
+	}
+
+	if (id < num_instances)
+		visibility[id] = uvec2(scan[lid] - visible, visible != 0u ? lod : INVISIBLE);
+
+	if (lid == 255u)
+		block_sums[gl_WorkGroupID.x] = scan[255];
+}
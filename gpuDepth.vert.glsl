@@ -0,0 +1,26 @@
+#version 430 core
+
+// shadowDepth.vert.glsl, for the GPU driven pipeline
+// (model matrix comes from the world transform buffer)
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 3) in uint draw_instance; // baseInstance of the draw
+
+struct InstanceData
+{
+	uint node;
+	uint mesh;
+	uint cluster;
+	uint pad;
+};
+
+layout(std430, binding = 1) readonly buffer World { mat4 world[]; };
+layout(std430, binding = 2) readonly buffer Instances { InstanceData instances[]; };
+
+// world to light clip space
+uniform mat4 VP;
+
+void main()
+{
+	mat4 M = world[instances[draw_instance].node];
+	gl_Position = VP * M * vec4(vertexPosition_modelspace, 1);
+}
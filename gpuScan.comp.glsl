@@ -0,0 +1,48 @@
+#version 430 core
+
+// exclusive prefix sum of the visible count of every group (in place)
+// one group walks all of them, 256 at a time
+layout(local_size_x = 256) in;
+
+layout(std430, binding = 5) buffer Blocks { uint block_sums[]; };
+layout(std430, binding = 7) writeonly buffer DrawCount { uint draw_count; };
+
+uniform uint num_blocks;
+
+shared uint scan[256];
+shared uint carry;
+
+void main()
+{
+	uint lid = gl_LocalInvocationID.x;
+	if (lid == 0u)
+		carry = 0u;
+	barrier();
+
+	for (uint base = 0u; base < num_blocks; base += 256u)
+	{
+		uint idx = base + lid;
+		uint v = idx < num_blocks ? block_sums[idx] : 0u;
+
+		scan[lid] = v;
+		barrier();
+		for (uint offset = 1u; offset < 256u; offset <<= 1u)
+		{
+			uint s = lid >= offset ? scan[lid - offset] : 0u;
+			barrier();
+			scan[lid] += s;
+			barrier();
+		}
+
+		if (idx < num_blocks)
+			block_sums[idx] = carry + scan[lid] - v;
+		barrier();
+
+		if (lid == 255u)
+			carry += scan[255];
+		barrier();
+	}
+
+	if (lid == 0u)
+		draw_count = carry;
+}
@@ -0,0 +1,488 @@
+#include "gpuScene.hpp"
+#include "controls.hpp"
+#include "loadShaders.hpp"
+#include "lod.hpp"
+#include "profiler.hpp"
+#include "residency.hpp"
+#include "shadows.hpp"
+#include "scene.hpp"
+#include <iostream>
+
+namespace
+{
+
+/// std430 layout of the indirect draw (DrawElementsIndirectCommand)
+struct DrawCommand
+{
+	GLuint count;
+	GLuint instance_count;
+	GLuint first_index;
+	GLint base_vertex;
+	GLuint base_instance;
+};
+
+/// grid cells across a mesh for LOD 1 (halved for each LOD after)
+const float LOD_CELLS = 64.f;
+
+/// a LOD has to drop at least this much of the previous one to be worth it
+const float LOD_MIN_REDUCTION = 0.75f;
+
+template<typename T>
+GLuint makeBuffer(GLenum target, const std::vector<T> &data, GLenum usage)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	glBufferData(target, data.size() * sizeof(T), data.data(), usage);
+	return buffer;
+}
+
+GLuint makeBuffer(GLenum target, std::size_t size, GLenum usage)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+	glBufferData(target, size, nullptr, usage);
+	return buffer;
+}
+
+GLuint numGroups(unsigned count)
+{
+	return (count + GpuScene::GROUP_SIZE - 1) / GpuScene::GROUP_SIZE;
+}
+
+}
+
+GpuScene::~GpuScene()
+{
+	release();
+}
+
+bool GpuScene::supported()
+{
+	// the ARB entry point only, GLEW 2.0 doesn't know GL 4.6 (its drivers have the extension too)
+	return GLEW_VERSION_4_3 && GLEW_ARB_indirect_parameters;
+}
+
+void GpuScene::release()
+{
+	GLuint *const buffers[] =
+	{
+		&vertex_buffer_, &uv_buffer_, &normal_buffer_, &face_buffer_, &instance_id_buffer_,
+		&node_buffer_, &world_buffer_, &instance_buffer_, &mesh_buffer_, &cluster_buffer_,
+		&visibility_buffer_, &block_buffer_, &command_buffer_, &count_buffer_
+	};
+	for (auto *b : buffers)
+	{
+		glDeleteBuffers(1, b);
+		*b = 0;
+	}
+
+	GLuint *const programs[] =
+	{
+		&transform_program_, &cull_program_, &scan_program_, &compact_program_
+	};
+	for (auto *p : programs)
+	{
+		glDeleteProgram(*p);
+		*p = 0;
+	}
+
+	if (resources_)
+	{
+		resources_->unreserve(gpu_bytes_);
+		resources_->release(texture_);
+		resources_->release(program_);
+		resources_->release(depth_program_);
+	}
+	resources_ = nullptr;
+	texture_ = nullptr;
+	program_ = nullptr;
+	depth_program_ = nullptr;
+
+	nodes_.clear();
+	instances_.clear();
+	mesh_descs_.clear();
+	clusters_.clear();
+	mesh_index_.clear();
+	geometry_ = Geometry();
+	build_failed_ = false;
+
+	num_nodes_ = 0;
+	num_instances_ = 0;
+	gpu_bytes_ = 0;
+}
+
+bool GpuScene::build(const std::vector<Scene*> &scenes, ResidencyManager &resources)
+{
+	PROFILE_SCOPE("gpu build");
+	release();
+
+	resources_ = &resources;
+	program_ = resources.acquireProgram("../gpuShading.vert.glsl", "../standardShading.frag.glsl");
+	depth_program_ = resources.acquireProgram("../gpuDepth.vert.glsl", "../shadowDepth.frag.glsl");
+	texture_ = resources.acquireTexture("../uvtemplate.bmp");
+	transform_program_ = loadComputeShader("../gpuTransform.comp.glsl");
+	cull_program_ = loadComputeShader("../gpuCull.comp.glsl");
+	scan_program_ = loadComputeShader("../gpuScan.comp.glsl");
+	compact_program_ = loadComputeShader("../gpuCompact.comp.glsl");
+	if (!program_ || !depth_program_ || !texture_ || !transform_program_ || !cull_program_ ||
+	    !scan_program_ || !compact_program_)
+	{
+		release();
+		return false;
+	}
+
+	transform_num_nodes_id_ = glGetUniformLocation(transform_program_, "num_nodes");
+	cull_planes_id_ = glGetUniformLocation(cull_program_, "frustum_planes");
+	cull_camera_id_ = glGetUniformLocation(cull_program_, "camera_position");
+	cull_view_id_ = glGetUniformLocation(cull_program_, "view_origin");
+	cull_num_instances_id_ = glGetUniformLocation(cull_program_, "num_instances");
+	scan_num_blocks_id_ = glGetUniformLocation(scan_program_, "num_blocks");
+	compact_num_instances_id_ = glGetUniformLocation(compact_program_, "num_instances");
+	vp_matrix_id_ = glGetUniformLocation(program_->id, "VP");
+	view_matrix_id_ = glGetUniformLocation(program_->id, "V");
+	light_id_ = glGetUniformLocation(program_->id, "LightDirection_worldspace");
+	texture_id_ = glGetUniformLocation(program_->id, "myTextureSampler");
+	depth_vp_id_ = glGetUniformLocation(depth_program_->id, "VP");
+	shadow_uniforms_.find(program_->id);
+
+	// flatten the node trees (parents before children)
+	for (const auto *scene : scenes)
+	{
+		if (!scene->root())
+			continue;
+
+		// the placement is a node of its own
+		GpuNode placement;
+		placement.local = scene->placement();
+		placement.parent = -1;
+		nodes_.push_back(placement);
+
+		addNode(scene->root(), GLint(nodes_.size() - 1));
+	}
+	if (build_failed_)
+	{
+		release();
+		return false;
+	}
+	if (instances_.empty())
+	{
+		std::cerr << "Nothing for the GPU driven pipeline" << std::endl;
+		release();
+		return false;
+	}
+
+	num_nodes_ = nodes_.size();
+	num_instances_ = instances_.size();
+	std::cout << "GPU scene: " << num_nodes_ << " nodes, "
+	    << num_instances_ << " cluster instances, "
+	    << mesh_descs_.size() << " meshes, "
+	    << clusters_.size() << " clusters" << std::endl;
+
+	// merged geometry
+	vertex_buffer_ = makeBuffer(GL_ARRAY_BUFFER, geometry_.vertices, GL_STATIC_DRAW);
+	uv_buffer_ = makeBuffer(GL_ARRAY_BUFFER, geometry_.uvs, GL_STATIC_DRAW);
+	normal_buffer_ = makeBuffer(GL_ARRAY_BUFFER, geometry_.normals, GL_STATIC_DRAW);
+	face_buffer_ = makeBuffer(GL_ELEMENT_ARRAY_BUFFER, geometry_.faces, GL_STATIC_DRAW);
+
+	std::vector<GLuint> instance_ids(num_instances_);
+	for (unsigned i = 0; i < num_instances_; ++i)
+		instance_ids[i] = i;
+	instance_id_buffer_ = makeBuffer(GL_ARRAY_BUFFER, instance_ids, GL_STATIC_DRAW);
+
+	// shader storage
+	node_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, nodes_, GL_STATIC_DRAW);
+	world_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, num_nodes_ * sizeof(glm::mat4), GL_DYNAMIC_COPY);
+	instance_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, instances_, GL_STATIC_DRAW);
+	mesh_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, mesh_descs_, GL_STATIC_DRAW);
+	cluster_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, clusters_, GL_STATIC_DRAW);
+	visibility_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, num_instances_ * 2 * sizeof(GLuint), GL_DYNAMIC_COPY);
+	block_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, numGroups(num_instances_) * sizeof(GLuint), GL_DYNAMIC_COPY);
+	command_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, num_instances_ * sizeof(DrawCommand), GL_DYNAMIC_COPY);
+	count_buffer_ = makeBuffer(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), GL_DYNAMIC_COPY);
+
+	// the buffers count against the budget like any other geometry
+	gpu_bytes_ = geometry_.vertices.size() * sizeof(glm::vec3) +
+	    geometry_.uvs.size() * sizeof(glm::vec2) +
+	    geometry_.normals.size() * sizeof(glm::vec3) +
+	    geometry_.faces.size() * sizeof(unsigned) +
+	    num_instances_ * sizeof(GLuint) +
+	    nodes_.size() * sizeof(GpuNode) +
+	    num_nodes_ * sizeof(glm::mat4) +
+	    instances_.size() * sizeof(GpuInstance) +
+	    mesh_descs_.size() * sizeof(GpuMeshDesc) +
+	    clusters_.size() * sizeof(GpuCluster) +
+	    num_instances_ * 2 * sizeof(GLuint) +
+	    numGroups(num_instances_) * sizeof(GLuint) +
+	    num_instances_ * sizeof(DrawCommand) +
+	    sizeof(GLuint);
+	resources.reserve(gpu_bytes_);
+
+	// the meshes' own buffers would hold the geometry twice, so evict them
+	// (they were all read from the binary cache, so they can be, and if the
+	// CPU path draws them again they are reloaded from it)
+	for (const auto &i : mesh_index_)
+		resources.evict(i.first);
+
+	// the CPU copies are done
+	nodes_ = std::vector<GpuNode>();
+	instances_ = std::vector<GpuInstance>();
+	mesh_descs_ = std::vector<GpuMeshDesc>();
+	clusters_ = std::vector<GpuCluster>();
+	mesh_index_ = std::unordered_map<Mesh*, GLuint>();
+	geometry_ = Geometry();
+
+	return true;
+}
+
+void GpuScene::addNode(const Node *node, GLint parent)
+{
+	GpuNode n;
+	n.local = node->transform();
+	n.parent = parent;
+	nodes_.push_back(n);
+
+	const GLuint idx = nodes_.size() - 1;
+	for (unsigned i = 0; i < node->numMeshes(); ++i)
+	{
+		const GLuint mesh = addMesh(node->mesh(i));
+		const GpuMeshDesc &desc = mesh_descs_[mesh];
+		for (unsigned c = 0; c < desc.num_clusters; ++c)
+		{
+			GpuInstance inst;
+			inst.node = idx;
+			inst.mesh = mesh;
+			inst.cluster = desc.first_cluster + c;
+			inst.pad = 0;
+			instances_.push_back(inst);
+		}
+	}
+
+	for (unsigned i = 0; i < node->numChildren(); ++i)
+		addNode(node->child(i), idx);
+}
+
+GLuint GpuScene::addMesh(Mesh *mesh)
+{
+	auto i = mesh_index_.find(mesh);
+	if (i != mesh_index_.end())
+		return i->second;
+
+	// the binary cache has the CPU side data (the scenes don't keep it)
+	// (after one failure the build is lost, so don't report the rest)
+	MeshData data;
+	if (!build_failed_ && !readMeshCache(mesh->cachePath(), data))
+	{
+		std::cerr << "GPU driven pipeline needs the mesh cache, "
+		    << mesh->cachePath() << " can't be read (check --cache)" << std::endl;
+		build_failed_ = true;
+	}
+
+	GpuMeshDesc desc = GpuMeshDesc();
+	desc.bounds_min = glm::vec4(mesh->boundsMin(), 1.f);
+	desc.bounds_max = glm::vec4(mesh->boundsMax(), 1.f);
+	desc.base_vertex = geometry_.vertices.size();
+
+	geometry_.vertices.insert(geometry_.vertices.end(), data.vertices.begin(), data.vertices.end());
+	geometry_.uvs.insert(geometry_.uvs.end(), data.uvs.begin(), data.uvs.end());
+	geometry_.normals.insert(geometry_.normals.end(), data.normals.begin(), data.normals.end());
+
+	// LOD 0 is the mesh itself
+	desc.num_lods = 1;
+	desc.lod_first[0] = geometry_.faces.size();
+	desc.lod_count[0] = data.faces.size();
+	geometry_.faces.insert(geometry_.faces.end(), data.faces.begin(), data.faces.end());
+
+	// coarser LODs index the same vertexes
+	const float diagonal = glm::length(mesh->boundsMax() - mesh->boundsMin());
+	std::vector<unsigned> lod_faces;
+	float cells = LOD_CELLS;
+	while (desc.num_lods < MAX_LODS && diagonal > 0.f)
+	{
+		clusterLod(data, diagonal / cells, lod_faces);
+
+		const unsigned prev_count = desc.lod_count[desc.num_lods - 1];
+		if (lod_faces.empty() || lod_faces.size() > prev_count * LOD_MIN_REDUCTION)
+			break;
+
+		const unsigned lod = desc.num_lods++;
+		desc.lod_first[lod] = geometry_.faces.size();
+		desc.lod_count[lod] = lod_faces.size();
+		desc.lod_distance[lod - 1] = diagonal * float(4 << lod);
+		geometry_.faces.insert(geometry_.faces.end(), lod_faces.begin(), lod_faces.end());
+
+		cells /= 2;
+	}
+	for (unsigned lod = desc.num_lods - 1; lod < MAX_LODS; ++lod)
+		desc.lod_distance[lod] = 1e30f;
+
+	// LOD 0 is culled by meshlet
+	desc.first_cluster = clusters_.size();
+	for (const auto &m : data.meshlets)
+	{
+		GpuCluster c;
+		c.sphere = glm::vec4(m.center, m.radius);
+		c.cone = glm::vec4(m.cone_axis, m.cone_cutoff);
+		c.first_index = desc.lod_first[0] + m.first_index;
+		c.num_indices = m.num_indices;
+		c.lod = 0;
+		c.pad = 0;
+		clusters_.push_back(c);
+	}
+
+	// coarser LODs (and meshes without meshlets) are one cluster, without a cone
+	const glm::vec3 center = (mesh->boundsMin() + mesh->boundsMax()) * 0.5f;
+	for (unsigned lod = data.meshlets.empty() ? 0 : 1; lod < desc.num_lods; ++lod)
+	{
+		GpuCluster c;
+		c.sphere = glm::vec4(center, diagonal * 0.5f);
+		c.cone = glm::vec4(0.f, 0.f, 1.f, 2.f);
+		c.first_index = desc.lod_first[lod];
+		c.num_indices = desc.lod_count[lod];
+		c.lod = lod;
+		c.pad = 0;
+		clusters_.push_back(c);
+	}
+	desc.num_clusters = clusters_.size() - desc.first_cluster;
+
+	mesh_descs_.push_back(desc);
+
+	const GLuint idx = mesh_descs_.size() - 1;
+	mesh_index_[mesh] = idx;
+	return idx;
+}
+
+void GpuScene::update()
+{
+	PROFILE_SCOPE("gpu transforms");
+	if (!num_instances_)
+		return;
+
+	// these stay bound for the frame's passes
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, node_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, world_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, instance_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mesh_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, visibility_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, block_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, command_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, count_buffer_);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, cluster_buffer_);
+
+	glUseProgram(transform_program_);
+	glUniform1ui(transform_num_nodes_id_, num_nodes_);
+	glDispatchCompute(numGroups(num_nodes_), 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuScene::cull(const Frustum &frustum, const Controls &controls, const glm::vec4 &view)
+{
+	const GLuint groups = numGroups(num_instances_);
+
+	// frustum, LOD and cone, visible count per group
+	const glm::vec3 camera = glm::vec3(glm::inverse(controls.viewMatrix())[3]);
+	glUseProgram(cull_program_);
+	glUniform4fv(cull_planes_id_, 6, &frustum.planes[0][0]);
+	glUniform3f(cull_camera_id_, camera.x, camera.y, camera.z);
+	glUniform4f(cull_view_id_, view.x, view.y, view.z, view.w);
+	glUniform1ui(cull_num_instances_id_, num_instances_);
+	glDispatchCompute(groups, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// prefix sum of the group counts
+	glUseProgram(scan_program_);
+	glUniform1ui(scan_num_blocks_id_, groups);
+	glDispatchCompute(1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// write the draws
+	glUseProgram(compact_program_);
+	glUniform1ui(compact_num_instances_id_, num_instances_);
+	glDispatchCompute(groups, 1, 1);
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuScene::drawIndirect(bool attributes)
+{
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	if (attributes)
+	{
+		glEnableVertexAttribArray(1);
+		glBindBuffer(GL_ARRAY_BUFFER, uv_buffer_);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glEnableVertexAttribArray(2);
+		glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	}
+
+	// one value per instance, so the shader sees the draw's baseInstance
+	glEnableVertexAttribArray(3);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_id_buffer_);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, 0, (void*)0);
+	glVertexAttribDivisor(3, 1);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, face_buffer_);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer_);
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, count_buffer_);
+
+	glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, 0,
+	    num_instances_, sizeof(DrawCommand));
+
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	glVertexAttribDivisor(3, 0);
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+	glDisableVertexAttribArray(2);
+	glDisableVertexAttribArray(3);
+}
+
+void GpuScene::renderDepth(const glm::mat4 &light_vp, const Frustum &light_frustum,
+    const glm::vec3 &light_dir, const Controls &controls)
+{
+	if (!num_instances_)
+		return;
+
+	cull(light_frustum, controls, glm::vec4(light_dir, 0.f));
+
+	glUseProgram(depth_program_->id);
+	glUniformMatrix4fv(depth_vp_id_, 1, GL_FALSE, &light_vp[0][0]);
+	drawIndirect(false);
+}
+
+void GpuScene::render(const Controls &controls, const Frustum &frustum,
+    const glm::vec3 &light_dir, const CascadedShadows *shadows)
+{
+	PROFILE_SCOPE("gpu scene");
+	if (!num_instances_ || !resources_->touch(texture_))
+		return;
+
+	{
+		PROFILE_SCOPE("gpu cull");
+		const glm::vec3 camera = glm::vec3(glm::inverse(controls.viewMatrix())[3]);
+		cull(frustum, controls, glm::vec4(camera, 1.f));
+	}
+
+	PROFILE_SCOPE("gpu draw");
+	glUseProgram(program_->id);
+
+	const glm::mat4 view_matrix = controls.viewMatrix();
+	const glm::mat4 vp = controls.projectionMatrix() * view_matrix;
+
+	glUniform3f(light_id_, light_dir.x, light_dir.y, light_dir.z);
+	glUniformMatrix4fv(vp_matrix_id_, 1, GL_FALSE, &vp[0][0]);
+	glUniformMatrix4fv(view_matrix_id_, 1, GL_FALSE, &view_matrix[0][0]);
+	CascadedShadows::apply(shadows, shadow_uniforms_);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture_->id());
+	glUniform1i(texture_id_, 0);
+
+	drawIndirect(true);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "frustum.hpp"
+#include "shadowUniforms.hpp"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class CascadedShadows;
+class Controls;
+class Mesh;
+class Node;
+class ResidencyManager;
+class Scene;
+class Texture;
+struct Program;
+
+/// GPU driven renderer for a set of scenes
+/// Node transforms, mesh bounds, LOD descriptors and clusters live in SSBOs.
+/// Each mesh instance is drawn as clusters: the meshlets of LOD 0, and one
+/// cluster for each coarser LOD. Each frame compute shaders update the world
+/// transforms, frustum cull and pick a LOD for every instance, frustum and
+/// normal cone cull the meshlets, compact the visible clusters with a prefix
+/// sum and write the indirect draws, which are drawn by one
+/// glMultiDrawElementsIndirectCount.
+/// The CPU work per frame does not depend on the number of objects.
+class GpuScene
+{
+public:
+	static constexpr unsigned MAX_LODS = 4;
+	static constexpr unsigned GROUP_SIZE = 256; ///< must match the compute shaders
+
+	GpuScene() = default;
+	GpuScene(const GpuScene&) = delete;
+	GpuScene& operator=(const GpuScene&) = delete;
+	~GpuScene();
+
+	/// does the driver have what we need (GL 4.3 and ARB_indirect_parameters)
+	static bool supported();
+
+	/// copy the scenes (and their geometry) into GPU buffers
+	/// the scenes' meshes are evicted, so the geometry is only resident once
+	/// the scenes must stay loaded while this is used
+	bool build(const std::vector<Scene*> &scenes, ResidencyManager &resources);
+
+	/// world transforms for this frame (before any of the passes)
+	void update();
+
+	/// depth only pass for a shadow cascade (LODs still picked from the camera)
+	void renderDepth(const glm::mat4 &light_vp, const Frustum &light_frustum,
+	    const glm::vec3 &light_dir, const Controls &controls);
+
+	/// light_dir is the direction the light shines (normalized)
+	void render(const Controls &controls, const Frustum &frustum,
+	    const glm::vec3 &light_dir, const CascadedShadows *shadows = nullptr);
+
+	unsigned numInstances() const { return num_instances_; }
+
+private: // types
+	// these match the std430 structs in the shaders
+
+	struct GpuNode
+	{
+		glm::mat4 local; ///< relative to parent
+		GLint parent; ///< -1 for none
+		GLint pad[3];
+	};
+
+	/// one cluster of a mesh on one node (one possible draw)
+	struct GpuInstance
+	{
+		GLuint node;
+		GLuint mesh;
+		GLuint cluster;
+		GLuint pad;
+	};
+
+	/// a meshlet of LOD 0, or all of a coarser LOD
+	struct GpuCluster
+	{
+		glm::vec4 sphere; ///< center, radius (model space)
+		glm::vec4 cone; ///< axis, cutoff (> 1 for no cone)
+		GLuint first_index;
+		GLuint num_indices;
+		GLuint lod;
+		GLuint pad;
+	};
+
+	struct GpuMeshDesc
+	{
+		glm::vec4 bounds_min; ///< model space
+		glm::vec4 bounds_max; ///< model space
+		GLuint base_vertex;
+		GLuint num_lods;
+		GLuint first_cluster;
+		GLuint num_clusters;
+		GLuint lod_first[MAX_LODS]; ///< first index of each LOD
+		GLuint lod_count[MAX_LODS]; ///< index count of each LOD
+		float lod_distance[MAX_LODS]; ///< use the next LOD beyond this distance
+	};
+
+	/// geometry of all meshes, in one set of buffers
+	struct Geometry
+	{
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		std::vector<unsigned> faces;
+	};
+
+private: // methods
+	void addNode(const Node *node, GLint parent);
+	GLuint addMesh(Mesh *mesh);
+	void release();
+
+	/// cull, pick LODs and write the indirect draws
+	/// view is the camera position (w = 1) or an orthographic view direction (w = 0)
+	void cull(const Frustum &frustum, const Controls &controls, const glm::vec4 &view);
+	/// draw what cull wrote (attributes is false for depth only)
+	void drawIndirect(bool attributes);
+
+private: // data
+	ResidencyManager *resources_ = nullptr;
+	Program *program_ = nullptr; ///< draw program (shared)
+	Program *depth_program_ = nullptr; ///< shadow depth program (shared)
+	Texture *texture_ = nullptr; ///< (shared)
+
+	// build time only
+	std::vector<GpuNode> nodes_;
+	std::vector<GpuInstance> instances_;
+	std::vector<GpuMeshDesc> mesh_descs_;
+	std::vector<GpuCluster> clusters_;
+	std::unordered_map<Mesh*, GLuint> mesh_index_;
+	Geometry geometry_;
+	bool build_failed_ = false;
+
+	unsigned num_nodes_ = 0;
+	unsigned num_instances_ = 0; ///< clusters of every mesh instance
+	std::size_t gpu_bytes_ = 0; ///< of all buffers (reserved with the residency manager)
+
+	// compute programs
+	GLuint transform_program_ = 0;
+	GLuint cull_program_ = 0;
+	GLuint scan_program_ = 0;
+	GLuint compact_program_ = 0;
+
+	// uniforms
+	GLint transform_num_nodes_id_ = -1;
+	GLint cull_planes_id_ = -1;
+	GLint cull_camera_id_ = -1;
+	GLint cull_view_id_ = -1;
+	GLint cull_num_instances_id_ = -1;
+	GLint scan_num_blocks_id_ = -1;
+	GLint compact_num_instances_id_ = -1;
+	GLint vp_matrix_id_ = -1;
+	GLint view_matrix_id_ = -1;
+	GLint light_id_ = -1;
+	GLint texture_id_ = -1;
+	GLint depth_vp_id_ = -1;
+	ShadowUniforms shadow_uniforms_;
+
+	// merged geometry
+	GLuint vertex_buffer_ = 0;
+	GLuint uv_buffer_ = 0;
+	GLuint normal_buffer_ = 0;
+	GLuint face_buffer_ = 0;
+	GLuint instance_id_buffer_ = 0; ///< 0..n-1, read through baseInstance
+
+	// shader storage
+	GLuint node_buffer_ = 0;
+	GLuint world_buffer_ = 0;
+	GLuint instance_buffer_ = 0;
+	GLuint mesh_buffer_ = 0;
+	GLuint cluster_buffer_ = 0;
+	GLuint visibility_buffer_ = 0; ///< per instance: offset in group, LOD
+	GLuint block_buffer_ = 0; ///< per group: visible count, then offset
+	GLuint command_buffer_ = 0; ///< indirect draws
+	GLuint count_buffer_ = 0; ///< number of indirect draws
+};
@@ -0,0 +1,63 @@
+#version 430 core
+
+// standardShading.vert.glsl, for the GPU driven pipeline
+// (model matrix comes from the world transform buffer)
+
+// Input vertex data, different for all executions of this shader
+layout(location = 0) in vec3 vertexPosition_modelspace;
+layout(location = 1) in vec2 vertexUV;
+layout(location = 2) in vec3 vertexNormal_modelspace;
+layout(location = 3) in uint draw_instance; // baseInstance of the draw
+
+// Output data - will be interpolated for each fragment
+out vec2 UV;
+out vec3 Position_worldspace;
+out vec3 Normal_cameraspace;
+out vec3 EyeDirection_cameraspace;
+out vec3 LightDirection_cameraspace;
+out float Depth_cameraspace; // distance in front of the camera
+
+struct InstanceData
+{
+	uint node;
+	uint mesh;
+	uint cluster;
+	uint pad;
+};
+
+layout(std430, binding = 1) readonly buffer World { mat4 world[]; };
+layout(std430, binding = 2) readonly buffer Instances { InstanceData instances[]; };
+
+// Values that stay constant for the whole draw
+uniform mat4 VP;
+uniform mat4 V;
+uniform vec3 LightDirection_worldspace; // the direction the light shines
+
+void main()
+{
+	mat4 M = world[instances[draw_instance].node];
+
+	// Position of the vertex, in worldspace: M * position
+	vec4 position_worldspace = M * vec4(vertexPosition_modelspace, 1);
+	Position_worldspace = position_worldspace.xyz;
+
+	// Output position of the vertex, in clip space
+	gl_Position = VP * position_worldspace;
+
+	// Vector that goes from the vertex to the camera, in camera space.
+	// In camera space, the camera is at the origin (0,0,0).
+	vec3 vertexPosition_cameraspace = (V * position_worldspace).xyz;
+	EyeDirection_cameraspace = vec3(0, 0, 0) - vertexPosition_cameraspace;
+	Depth_cameraspace = -vertexPosition_cameraspace.z;
+
+	// Vector that goes from the vertex to the light, in camera space.
+	// The light is directional, so it is the same for every vertex.
+	LightDirection_cameraspace = (V * vec4(-LightDirection_worldspace, 0)).xyz;
+
+	// Normal of the the vertex, in camera space
+	// Only correct if ModelMatrix does not scale the model! Use its inverse transpose if not.
+	Normal_cameraspace = (V * M * vec4(vertexNormal_modelspace, 0)).xyz;
+
+	// UV of the vertex. No special space for this one.
+	UV = vertexUV;
+}
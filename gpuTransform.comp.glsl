@@ -0,0 +1,36 @@
+#version 430 core
+
+// world transform of every node
+layout(local_size_x = 256) in;
+
+struct NodeData
+{
+	mat4 local; // relative to parent
+	int parent; // -1 for none
+	int pad0;
+	int pad1;
+	int pad2;
+};
+
+layout(std430, binding = 0) readonly buffer Nodes { NodeData nodes[]; };
+layout(std430, binding = 1) writeonly buffer World { mat4 world[]; };
+
+uniform uint num_nodes;
+
+void main()
+{
+	uint id = gl_GlobalInvocationID.x;
+	if (id >= num_nodes)
+		return;
+
+	// walk up to the root (trees are shallow)
+	mat4 m = nodes[id].local;
+	int p = nodes[id].parent;
+	while (p >= 0)
+	{
+		m = nodes[p].local * m;
+		p = nodes[p].parent;
+	}
+
+	world[id] = m;
+}
@@ -0,0 +1,13 @@
+#include "hash.hpp"
+
+std::uint64_t hashBytes(const void *data, std::size_t size, std::uint64_t seed)
+{
+	const unsigned char *p = static_cast<const unsigned char*>(data);
+	std::uint64_t h = seed;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		h ^= p[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
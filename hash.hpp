@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// 64 bit FNV-1a hash, chain calls by passing the last result as seed
+std::uint64_t hashBytes(const void *data, std::size_t size,
+    std::uint64_t seed = 14695981039346656037ull);
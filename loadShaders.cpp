@@ -4,96 +4,82 @@
 #include <sstream>
 #include <vector>
 
-GLuint loadShaders(const std::string &vertex_file_path, const std::string &fragment_file_path)
+namespace
+{
+
+const char* shaderTypeName(GLenum type)
 {
-	// open vertex shader code file
-	std::ifstream vertex_shader_stream(vertex_file_path.c_str(), std::ios::in);
-	if (!vertex_shader_stream.is_open())
+	switch (type)
 	{
-		std::cerr << "Failed to open vertex shader " << vertex_file_path << std::endl;
-		return 0;
+	case GL_VERTEX_SHADER: return "vertex";
+	case GL_FRAGMENT_SHADER: return "fragment";
+	case GL_COMPUTE_SHADER: return "compute";
+	default: return "unknown";
 	}
+}
 
-	// open fragment shader code file
-	std::ifstream fragment_shader_stream(fragment_file_path.c_str(), std::ios::in);
-	if (!fragment_shader_stream.is_open())
+/// read and compile one shader, returns 0 on failure
+GLuint compileShader(GLenum type, const std::string &file_path)
+{
+	const char *const type_name = shaderTypeName(type);
+
+	// open shader code file
+	std::ifstream shader_stream(file_path.c_str(), std::ios::in);
+	if (!shader_stream.is_open())
 	{
-		std::cerr << "Failed to open fragment shader " << fragment_file_path << std::endl;
+		std::cerr << "Failed to open " << type_name << " shader " << file_path << std::endl;
 		return 0;
 	}
 
-	// read vertex shader code from file
-	std::stringstream vstr;
-	vstr << vertex_shader_stream.rdbuf();
-
-	std::string vertex_shader_text = vstr.str();
-
-	vertex_shader_stream.close();
+	// read shader code from file
+	std::stringstream str;
+	str << shader_stream.rdbuf();
 
-	// read fragment shader code from file
-	std::stringstream fstr;
-	fstr << fragment_shader_stream.rdbuf();
+	std::string shader_text = str.str();
 
-	std::string fragment_shader_text = fstr.str();
+	shader_stream.close();
 
-	fragment_shader_stream.close();
+	// compile shader
+	std::cout << "Compiling " << type_name << " shader: " << file_path << std::endl;
+	const char *const source_pointer = shader_text.c_str();
 
-	// compile vertex shader
-	std::cout << "Compiling vertex shader: " << vertex_file_path << std::endl;
-	const char *const vertex_source_pointer = vertex_shader_text.c_str();
+	GLuint shader_id = glCreateShader(type);
+	glShaderSource(shader_id, 1, &source_pointer, NULL);
+	glCompileShader(shader_id);
 
-	GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex_shader_id, 1, &vertex_source_pointer, NULL);
-	glCompileShader(vertex_shader_id);
-
-	//--- check compile result of vertex shader
+	//--- check compile result
 	GLint result = GL_FALSE;
 	int info_log_length = 0;
-	glGetShaderiv(vertex_shader_id, GL_COMPILE_STATUS, &result);
-	glGetShaderiv(vertex_shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
+	glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
 	if (info_log_length > 0)
 	{
-		std::vector<char> vertex_shader_error_message(info_log_length+1);
-		glGetShaderInfoLog(vertex_shader_id, info_log_length, NULL, &vertex_shader_error_message[0]);
-		std::cerr << &vertex_shader_error_message[0] << std::endl;
+		std::vector<char> shader_error_message(info_log_length+1);
+		glGetShaderInfoLog(shader_id, info_log_length, NULL, &shader_error_message[0]);
+		std::cerr << &shader_error_message[0] << std::endl;
 	}
 	if (result != GL_TRUE)
 	{
-		std::cerr << "Vertex shader compile gave result: " << result << std::endl;
+		std::cerr << "Compiling " << file_path << " gave result: " << result << std::endl;
+		glDeleteShader(shader_id);
 		return 0;
 	}
 
-	// compile fragment shader
-	std::cout << "Compiling fragment shader: " << fragment_file_path << std::endl;
-	const char *const fragment_source_pointer = fragment_shader_text.c_str();
-
-	GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment_shader_id, 1, &fragment_source_pointer, NULL);
-	glCompileShader(fragment_shader_id);
-
-	//--- check compile result of fragment shader
-	glGetShaderiv(fragment_shader_id, GL_COMPILE_STATUS, &result);
-	glGetShaderiv(fragment_shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
-	if (info_log_length > 0)
-	{
-		std::vector<char> fragment_shader_error_message(info_log_length+1);
-		glGetShaderInfoLog(fragment_shader_id, info_log_length, NULL, &fragment_shader_error_message[0]);
-		std::cerr << &fragment_shader_error_message[0] << std::endl;
-	}
-	if (result != GL_TRUE)
-	{
-		std::cerr << "Fragment shader compile gave result: " << result << std::endl;
-		return 0;
-	}
+	return shader_id;
+}
 
-	// link program
+/// link compiled shaders, and delete them, returns 0 on failure
+GLuint linkProgram(const GLuint *shader_ids, unsigned count)
+{
 	std::cout << "Linking program" << std::endl;
 	GLuint program_id = glCreateProgram();
-	glAttachShader(program_id, vertex_shader_id);
-	glAttachShader(program_id, fragment_shader_id);
+	for (unsigned i = 0; i < count; ++i)
+		glAttachShader(program_id, shader_ids[i]);
 	glLinkProgram(program_id);
 
 	// check program
+	GLint result = GL_FALSE;
+	int info_log_length = 0;
 	glGetProgramiv(program_id, GL_LINK_STATUS, &result);
 	glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
 	if (info_log_length > 0)
@@ -102,18 +88,47 @@ GLuint loadShaders(const std::string &vertex_file_path, const std::string &fragm
 		glGetProgramInfoLog(program_id, info_log_length, NULL, &program_error_message[0]);
 		std::cerr << &program_error_message[0] << std::endl;
 	}
+
+	for (unsigned i = 0; i < count; ++i)
+	{
+		glDetachShader(program_id, shader_ids[i]);
+		glDeleteShader(shader_ids[i]);
+	}
+
 	if (result != GL_TRUE)
 	{
 		std::cerr << "Linker gave result: " << result << std::endl;
+		glDeleteProgram(program_id);
 		return 0;
 	}
 
-	glDetachShader(program_id, vertex_shader_id);
-	glDetachShader(program_id, fragment_shader_id);
+	return program_id;
+}
 
-	glDeleteShader(vertex_shader_id);
-	glDeleteShader(fragment_shader_id);
+}
 
-	return program_id;
+GLuint loadShaders(const std::string &vertex_file_path, const std::string &fragment_file_path)
+{
+	const GLuint vertex_shader_id = compileShader(GL_VERTEX_SHADER, vertex_file_path);
+	if (!vertex_shader_id)
+		return 0;
+
+	const GLuint fragment_shader_id = compileShader(GL_FRAGMENT_SHADER, fragment_file_path);
+	if (!fragment_shader_id)
+	{
+		glDeleteShader(vertex_shader_id);
+		return 0;
+	}
+
+	const GLuint shader_ids[] = {vertex_shader_id, fragment_shader_id};
+	return linkProgram(shader_ids, 2);
 }
 
+GLuint loadComputeShader(const std::string &compute_file_path)
+{
+	const GLuint compute_shader_id = compileShader(GL_COMPUTE_SHADER, compute_file_path);
+	if (!compute_shader_id)
+		return 0;
+
+	return linkProgram(&compute_shader_id, 1);
+}
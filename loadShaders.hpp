@@ -4,4 +4,4 @@
 #include <string>
 
 GLuint loadShaders(const std::string &vertex_file_path, const std::string &fragment_file_path);
-
+GLuint loadComputeShader(const std::string &compute_file_path);
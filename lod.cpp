@@ -0,0 +1,50 @@
+#include "lod.hpp"
+#include <cstdint>
+#include <unordered_map>
+
+void clusterLod(const MeshData &data, float cell_size, std::vector<unsigned> &faces)
+{
+	faces.clear();
+	if (data.vertices.empty() || cell_size <= 0.f)
+	{
+		faces = data.faces;
+		return;
+	}
+
+	glm::vec3 box_min = data.vertices[0];
+	for (const auto &v : data.vertices)
+		box_min = glm::min(box_min, v);
+
+	// representative vertex of each vertex
+	std::vector<unsigned> remap(data.vertices.size());
+	std::unordered_map<std::uint64_t, unsigned> cells;
+	cells.reserve(data.vertices.size());
+
+	for (unsigned i = 0; i < data.vertices.size(); ++i)
+	{
+		const glm::vec3 cell = (data.vertices[i] - box_min) / cell_size;
+
+		// 21 bits per axis
+		const std::uint64_t key =
+		      (std::uint64_t(cell.x) & 0x1fffff)
+		    | (std::uint64_t(cell.y) & 0x1fffff) << 21
+		    | (std::uint64_t(cell.z) & 0x1fffff) << 42;
+
+		auto ins = cells.insert(std::make_pair(key, i));
+		remap[i] = ins.first->second;
+	}
+
+	faces.reserve(data.faces.size());
+	for (unsigned i = 0; i + 2 < data.faces.size(); i += 3)
+	{
+		const unsigned a = remap[data.faces[i]];
+		const unsigned b = remap[data.faces[i + 1]];
+		const unsigned c = remap[data.faces[i + 2]];
+		if (a == b || b == c || a == c)
+			continue;
+
+		faces.push_back(a);
+		faces.push_back(b);
+		faces.push_back(c);
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "mesh.hpp"
+#include <vector>
+
+/// Simplify a mesh by vertex clustering: vertexes in the same grid cell merge
+/// into the first one seen there, and triangles which collapse are dropped.
+/// The result indexes the original vertexes, so every LOD of a mesh can share
+/// one vertex buffer.
+void clusterLod(const MeshData &data, float cell_size, std::vector<unsigned> &faces);
@@ -1,14 +1,24 @@
 // needs to be before GL
 #include <GL/glew.h>
+#include "allocCounter.hpp"
 #include "controls.hpp"
-#include "loadBmp.h"
-#include "loadShaders.hpp"
+#include "frustum.hpp"
+#include "gpuScene.hpp"
+#include "manifest.hpp"
+#include "overlay.hpp"
+#include "profiler.hpp"
+#include "regression.hpp"
+#include "residency.hpp"
+#include "scene.hpp"
+#include "shadows.hpp"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include <GLFW/glfw3.h>
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -88,317 +98,334 @@ void dumpScene(const aiScene *scene)
 	}
 }
 
-//----------------------------------------------------------------------------
-/// One mesh in the scene
-class Mesh
+/// fill the overlay with the most expensive profile markers
+void profileOverlay(TextOverlay &overlay)
 {
-public:
-	Mesh() = default;
-
-	Mesh(GLuint vertex_buffer,
-	     GLuint uv_buffer,
-	     GLuint normal_buffer,
-	     GLuint face_buffer,
-	     unsigned num_faces)
-	: vertex_buffer_(vertex_buffer)
-	, uv_buffer_(uv_buffer)
-	, normal_buffer_(normal_buffer)
-	, face_buffer_(face_buffer)
-	, num_faces_(num_faces)
+	const Profiler &prof = profiler();
+	const unsigned num_stats = prof.numStats();
+
+	// sort pointers in place (no allocation)
+	const Profiler::Stat *top[Profiler::MAX_STATS];
+	for (unsigned i = 0; i < num_stats; ++i)
+		top[i] = &prof.stat(i);
+	std::sort(top, top + num_stats,
+		[](const Profiler::Stat *a, const Profiler::Stat *b)
+		{
+			return std::max(a->avg_cpu_ms, a->avg_gpu_ms) > std::max(b->avg_cpu_ms, b->avg_gpu_ms);
+		});
+
+	overlay.clear();
+	overlay.print(0, 0, "MARKER          CPU MS   GPU MS");
+
+	char line[64];
+	const unsigned rows = std::min(num_stats, 10u);
+	for (unsigned i = 0; i < rows; ++i)
 	{
+		snprintf(line, sizeof(line), "%-12.12s %9.3f %8.3f",
+		    top[i]->name, top[i]->avg_cpu_ms, top[i]->avg_gpu_ms);
+		overlay.print(0, i + 1, line);
 	}
 
-	~Mesh()
+	if (!prof.hasGpuTimers())
 	{
-		glDeleteBuffers(1, &vertex_buffer_);
-		glDeleteBuffers(1, &uv_buffer_);
-		glDeleteBuffers(1, &normal_buffer_);
-		glDeleteBuffers(1, &face_buffer_);
+		overlay.print(0, rows + 1, "NO GPU TIMERS");
+	}
+	else if (prof.droppedFrames())
+	{
+		snprintf(line, sizeof(line), "LATE GPU FRAMES %u", prof.droppedFrames());
+		overlay.print(0, rows + 1, line);
 	}
 
-	void render()
+	if (prof.droppedMarkers())
 	{
-		// attribute 0 - vertex data
-		glEnableVertexAttribArray(0);
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
-		glVertexAttribPointer(
-			0,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
-			3,                  // size
-			GL_FLOAT,           // type
-			GL_FALSE,           // normalized?
-			0,                  // stride
-			(void*)0            // array buffer offset
-		);
-
-		glEnableVertexAttribArray(1);
-		glBindBuffer(GL_ARRAY_BUFFER, uv_buffer_);
-		glVertexAttribPointer(
-			1,                                // attribute. No particular reason for 1, but must match the layout in the shader.
-			2,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		glEnableVertexAttribArray(2);
-		glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_);
-		glVertexAttribPointer(
-			2,                                // attribute
-			3,                                // size
-			GL_FLOAT,                         // type
-			GL_FALSE,                         // normalized?
-			0,                                // stride
-			(void*)0                          // array buffer offset
-		);
-
-		// draw the triangles!
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, face_buffer_);
-		glDrawElements(GL_TRIANGLES, num_faces_, GL_UNSIGNED_INT, (void*)0);
-
-		// done
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+		snprintf(line, sizeof(line), "DROPPED MARKERS %u", prof.droppedMarkers());
+		overlay.print(0, rows + 2, line);
 	}
+}
 
-protected: // data
-	GLuint vertex_buffer_ = 0; ///< vertex buffer id
-	GLuint uv_buffer_ = 0;     ///< uv buffer id
-	GLuint normal_buffer_ = 0; ///<  normal buffer id
-	GLuint face_buffer_ = 0;   ///< faces hold indexes of vertexes
-	unsigned num_faces_ = 0;
+/// how to load and draw
+struct WorldOptions
+{
+	bool gpu_driven = false; ///< cull and build draws with compute shaders
+	bool use_shadows = true; ///< cascaded shadow maps
 };
 
-bool hasMeshes(const aiNode *node)
+/// everything drawn for one set of models
+struct World
 {
-	if (node->mNumMeshes > 0)
-		return true;
-
-	for (unsigned i = 0; i < node->mNumChildren; ++i)
-	{
-		if (hasMeshes(node->mChildren[i]))
-			return true;
-	}
+	std::vector<Scene*> scenes;
+	GpuScene *gpu_scene = nullptr;
+	CascadedShadows *shadows = nullptr;
+	glm::vec3 light_dir = glm::normalize(glm::vec3(-1, -1, -1)); ///< the sun, for shading and shadows
+};
 
-	return false;
+void unloadWorld(World &world)
+{
+	delete world.shadows;
+	delete world.gpu_scene;
+	for (auto *scene : world.scenes)
+		delete scene;
+	world = World();
 }
 
-class Node
+bool loadWorld(World &world, const std::vector<ManifestEntry> &models,
+    ResidencyManager &resources, const WorldOptions &options)
 {
-public:
-	Node() = default;
-
-	void resolveMeshes(const aiNode *node, const std::vector<Mesh*> &meshes)
+	for (const auto &m : models)
 	{
-		name_ = std::string(node->mName.C_Str());
-		std::cout << "Creating node " << name_ << std::endl;
-
-		for (unsigned i = 0; i < node->mNumChildren; ++i)
+		Scene *scene = new Scene;
+		world.scenes.push_back(scene);
+		if (!scene->load(m.path.c_str(), resources, m.placement))
 		{
-			aiNode *child = node->mChildren[i];
-			if (hasMeshes(child))
-			{
-				Node *child_node = new Node;
-				child_node->resolveMeshes(child, meshes);
-				children_.push_back(child_node);
-			}
+			return false;
 		}
+	}
 
-		// pull mesh pointers from global mesh array via index
-		for (unsigned i = 0; i < node->mNumMeshes; ++i)
+	if (options.gpu_driven)
+	{
+		if (!GpuScene::supported())
 		{
-			const unsigned mesh_idx = node->mMeshes[i];
-			meshes_.push_back(meshes[mesh_idx]);
+			std::cerr << "GPU driven pipeline needs GL 4.3 and ARB_indirect_parameters" << std::endl;
+		}
+		else
+		{
+			world.gpu_scene = new GpuScene;
+			if (!world.gpu_scene->build(world.scenes, resources))
+			{
+				delete world.gpu_scene;
+				world.gpu_scene = nullptr;
+			}
 		}
+		if (!world.gpu_scene)
+			std::cerr << "Using the CPU pipeline" << std::endl;
 	}
 
-	void render()
+	if (options.use_shadows)
 	{
-		// TODO apply matrix transformation
-		for (const auto &m : meshes_)
-			m->render();
-
-		for (const auto &n : children_)
-			n->render();
+		world.shadows = new CascadedShadows;
+		if (!world.shadows->init(resources))
+		{
+			std::cerr << "No shadows" << std::endl;
+			delete world.shadows;
+			world.shadows = nullptr;
+		}
+		else
+		{
+			world.shadows->setLightDirection(world.light_dir);
+		}
 	}
 
-protected:
-	std::string name_; ///< name (used in animation)
-	glm::mat4 transform_; ///< relative to parent
-	std::vector<Node*> children_; ///< tree of children
-	std::vector<Mesh*> meshes_; ///< meshes on this node
-};
+	return true;
+}
 
-class Scene
+/// one frame, everything but the overlay
+void drawWorld(World &world, Controls &controls, ResidencyManager &resources, GLFWwindow *window)
 {
-public:
-	Scene() = default;
+	// erase screen before drawing
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	~Scene()
-	{
-		// Cleanup VBO
-		glDeleteTextures(1, &texture_);
-		glDeleteProgram(program_id_);
-	}
+	// Compute the MVP matrix from keyboard and mouse input
+	controls.computeMatricesFromInputs();
+	const Frustum frustum = extractFrustum(controls.projectionMatrix() * controls.viewMatrix());
 
-	bool load(const char *obj_path)
-	{
-		Assimp::Importer importer;
-		// TODO: other flags? configuration?
-		const unsigned flags = aiProcess_CalcTangentSpace
-		    | aiProcess_Triangulate
-		    | aiProcess_JoinIdenticalVertices
-		    | aiProcess_SortByPType;
-		const aiScene *scene = importer.ReadFile(obj_path, flags);
-		if (!scene)
-		{
-			std::cerr << "Failed to import " << obj_path << std::endl;
-			return false;
-		}
-
-		// read and compile shaders
-		program_id_ = loadShaders("../standardShading.vert.glsl", "../standardShading.frag.glsl");
-
-		// get a handle for our "MVP" uniform
-		matrix_id_ = glGetUniformLocation(program_id_, "MVP");
-		view_matrix_id_ = glGetUniformLocation(program_id_, "V");
-		model_matrix_id_ = glGetUniformLocation(program_id_, "M");
+	GpuScene *gpu_scene = world.gpu_scene;
+	CascadedShadows *shadows = world.shadows;
 
-		// load the texture using any two methods
-		texture_ = loadBmp("../uvtemplate.bmp");
-		//texture_ = loadDDS("uvtemplate.DDS");
+	if (gpu_scene)
+		gpu_scene->update();
 
-		// get a handle for our texture sampler uniform
-		texture_id_  = glGetUniformLocation(program_id_, "myTextureSampler");
-
-		glUseProgram(program_id_);
-		light_id_ = glGetUniformLocation(program_id_, "LightPosition_worldspace");
-
-		// TODO: materials
-		// TODO: animations
+	if (shadows)
+	{
+		// each cascade is its own marker, so the cached ones show what they save
+		static const char *const cascade_names[] = {"cascade 0", "cascade 1", "cascade 2", "cascade 3"};
+		static_assert(CascadedShadows::NUM_CASCADES <= 4, "name the cascades");
 
-		// meshes
-		for (unsigned i = 0; i < scene->mNumMeshes; ++i)
+		PROFILE_SCOPE("shadows");
+		shadows->update(controls);
+		for (unsigned c = 0; c < CascadedShadows::NUM_CASCADES; ++c)
 		{
-			const aiMesh *paiMesh = scene->mMeshes[i];
-			if (paiMesh->mNumAnimMeshes != 0)
-			{
-				std::cerr << "Mesh " << i << " with animations!" << std::endl;
-			}
-			// TODO: handle other texture maps...
-			const bool has_texture_coords = paiMesh->HasTextureCoords(0);
-			const bool has_normals = paiMesh->HasNormals();
-
-			const glm::vec3 zero(0.f, 0.f, 0.f);
-			std::vector<glm::vec3> vertex_buffer_data;
-			std::vector<glm::vec2> uv_buffer_data;
-			std::vector<glm::vec3> normal_buffer_data;
+			if (!shadows->needsRender(c))
+				continue;
 
-			for (unsigned j = 0; j < paiMesh->mNumVertices; ++j)
+			PROFILE_SCOPE(cascade_names[c]);
+			shadows->beginCascade(c);
+			if (gpu_scene)
 			{
-				const aiVector3D *pPos = &paiMesh->mVertices[j];
-				vertex_buffer_data.push_back(glm::vec3(pPos->x, pPos->y, pPos->z));
-
-				if (has_texture_coords)
-				{
-					const aiVector3D *pTexCoord = &paiMesh->mTextureCoords[0][j];
-					uv_buffer_data.push_back(glm::vec2(pTexCoord->x, pTexCoord->y));
-				}
-				else
-				{
-					uv_buffer_data.push_back(glm::vec2(zero.x, zero.y));
-				}
-
-				if (has_normals)
-				{
-					const aiVector3D *pNormal = &paiMesh->mNormals[j];
-					normal_buffer_data.push_back(glm::vec3(pNormal->x, pNormal->y, pNormal->z));
-				}
-				else
-				{
-					normal_buffer_data.push_back(glm::vec3(zero.x, zero.y, zero.z));
-				}
+				gpu_scene->renderDepth(shadows->lightMatrix(c), shadows->lightFrustum(c),
+				    shadows->lightDirection(), controls);
 			}
-
-			std::vector<unsigned> face_buffer_data;
-			for (unsigned i = 0; i < paiMesh->mNumFaces; ++i)
+			else
 			{
-				const aiFace &face = paiMesh->mFaces[i];
-				for (unsigned j = 0; j < face.mNumIndices; ++j)
-				{
-					face_buffer_data.push_back(face.mIndices[j]);
-				}
+				for (auto *scene : world.scenes)
+					scene->renderDepth(shadows->lightMatrix(c), shadows->lightFrustum(c),
+					    shadows->lightDirection(), shadows->depthMvpId());
 			}
+		}
 
-			GLuint vertex_buffer;
-			glGenBuffers(1, &vertex_buffer);
-			glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-			glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(glm::vec3), &vertex_buffer_data[0], GL_STATIC_DRAW);
+		int width = 0, height = 0;
+		glfwGetFramebufferSize(window, &width, &height);
+		shadows->endCascades(width, height);
+	}
+
+	if (gpu_scene)
+	{
+		gpu_scene->render(controls, frustum, world.light_dir, shadows);
+	}
+	else
+	{
+		// one marker per pass (not per scene), so many scenes don't fill the frame
+		{
+			PROFILE_SCOPE("cull");
+			for (auto *scene : world.scenes)
+				scene->cull(frustum);
+		}
+		{
+			PROFILE_SCOPE("draw");
+			for (auto *scene : world.scenes)
+				scene->render(controls, frustum, world.light_dir, shadows);
+		}
+	}
 
-			GLuint uv_buffer;
-			glGenBuffers(1, &uv_buffer);
-			glBindBuffer(GL_ARRAY_BUFFER, uv_buffer);
-			glBufferData(GL_ARRAY_BUFFER, uv_buffer_data.size() * sizeof(glm::vec2), &uv_buffer_data[0], GL_STATIC_DRAW);
+	resources.endFrame();
+}
 
-			GLuint normal_buffer;
-			glGenBuffers(1, &normal_buffer);
-			glBindBuffer(GL_ARRAY_BUFFER, normal_buffer);
-			glBufferData(GL_ARRAY_BUFFER, normal_buffer_data.size() * sizeof(glm::vec3), &normal_buffer_data[0], GL_STATIC_DRAW);
+/// the first frames size the arenas and fill the caches, don't time them
+const unsigned WARMUP_FRAMES = 3;
 
-			GLuint face_buffer;
-			glGenBuffers(1, &face_buffer);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, face_buffer);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, face_buffer_data.size() * sizeof(face_buffer_data[0]), &face_buffer_data[0], GL_STATIC_DRAW);
+/// run the replay started on controls, as fast as it goes
+/// returns false if the window was closed first
+bool replayFrames(World &world, Controls &controls, ResidencyManager &resources,
+    GLFWwindow *window, std::vector<float> &frame_ms)
+{
+	frame_ms.clear();
+	frame_ms.reserve(controls.replayFrames());
 
-			meshes_.push_back(new Mesh(vertex_buffer, uv_buffer, normal_buffer, face_buffer, face_buffer_data.size()));
+	unsigned frame = 0;
+	double last_time = glfwGetTime();
+	while (!controls.replayDone())
+	{
+		profiler().beginFrame();
+		{
+			PROFILE_SCOPE("frame");
+			drawWorld(world, controls, resources, window);
 		}
+		profiler().endFrame();
+
+		glfwSwapBuffers(window);
+		glfwPollEvents();
 
-		root_ = new Node;
-		root_->resolveMeshes(scene->mRootNode, meshes_);
+		const double now = glfwGetTime();
+		if (frame++ >= WARMUP_FRAMES)
+			frame_ms.push_back(float((now - last_time) * 1000));
+		last_time = now;
 
-		return true;
+		if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS || glfwWindowShouldClose(window))
+			return false;
 	}
+	return true;
+}
 
-	void render(Controls *controls)
-	{
-		glUseProgram(program_id_);
+void printFrameStats(const FrameStats &st)
+{
+	std::cout << "frames " << st.frames
+	    << ", avg " << st.avg_ms
+	    << ", p50 " << st.p50_ms
+	    << ", p90 " << st.p90_ms
+	    << ", p99 " << st.p99_ms
+	    << ", max " << st.max_ms << " ms";
+}
 
-		// Compute the MVP matrix from keyboard and mouse input
-		controls->computeMatricesFromInputs();
-		glm::mat4 projection_matrix = controls->projectionMatrix();
+/// how to judge a regression run
+struct RegressionOptions
+{
+	std::string baseline_path;
+	bool write_baseline = false; ///< record the results as the new baseline
+	float tolerance_pct = 10; ///< allowed slowdown
+	float slack_ms = 0.25f; ///< allowed on top (timer noise)
+	float timestep = 1.f / 60; ///< seconds per replay frame
+};
 
-		glm::mat4 view_matrix = controls->viewMatrix();
-		glm::mat4 model_matrix = glm::mat4(1.0);
-		glm::mat4 mvp = projection_matrix * view_matrix * model_matrix;
+/// replay every recording over every set of models, and compare to the baseline
+/// returns the exit code (5 for slower than the baseline)
+int runRegression(const RegressionSuite &suite, const RegressionOptions &options,
+    const WorldOptions &world_options, GLFWwindow *window, Controls &controls,
+    ResidencyManager &resources)
+{
+	Baseline baseline;
+	if (!options.write_baseline && !readBaseline(options.baseline_path.c_str(), baseline))
+		return 1;
 
-		glm::vec3 light_pos = glm::vec3(4,4,4);
-		glUniform3f(light_id_, light_pos.x, light_pos.y, light_pos.z);
+	Baseline results;
+	std::vector<float> frame_ms;
+	unsigned regressions = 0;
+	unsigned missing = 0;
 
-		// set model view projection matrix
-		glUniformMatrix4fv(matrix_id_, 1, GL_FALSE, &mvp[0][0]);
-		glUniformMatrix4fv(model_matrix_id_, 1, GL_FALSE, &model_matrix[0][0]);
-		glUniformMatrix4fv(view_matrix_id_, 1, GL_FALSE, &view_matrix[0][0]);
+	for (const auto &m : suite.models)
+	{
+		World world;
+		if (!loadWorld(world, m.entries, resources, world_options))
+		{
+			unloadWorld(world);
+			return 4;
+		}
 
-		root_->render();
-	}
+		for (const auto &r : suite.recordings)
+		{
+			if (!controls.startReplay(r.path.c_str(), options.timestep))
+			{
+				unloadWorld(world);
+				return 4;
+			}
 
-private:
-	Node *root_ = nullptr; ///< root of the model
-	std::vector<Mesh*> meshes_; ///< meshes used by the model
+			const bool finished = replayFrames(world, controls, resources, window, frame_ms);
+			controls.stopReplay();
+			if (!finished)
+			{
+				std::cerr << "Regression run stopped" << std::endl;
+				unloadWorld(world);
+				return 1;
+			}
 
-	GLuint program_id_ = 0; ///< compiled vertex and shader program
+			const std::string name = m.name + '@' + r.name;
+			const FrameStats st = frameStats(frame_ms);
+			results[name] = st;
 
-	// handles of "MVP" uniform
-	GLuint matrix_id_ = 0;
-	GLuint view_matrix_id_ = 0;
-	GLuint model_matrix_id_ = 0;
+			std::cout << name << ": ";
+			printFrameStats(st);
 
-	GLuint texture_ = 0; ///< texture id (image data in OpenGL)
-	GLuint texture_id_ = 0; ///< handle for our texture sampler uniform (for shader)
+			auto base = baseline.find(name);
+			if (options.write_baseline)
+			{
+				std::cout << std::endl;
+			}
+			else if (base == baseline.end())
+			{
+				std::cout << " NO BASELINE" << std::endl;
+				++missing;
+			}
+			else if (!withinTolerance(base->second, st, options.tolerance_pct, options.slack_ms))
+			{
+				std::cout << " SLOWER (baseline p50 " << base->second.p50_ms
+				    << ", p90 " << base->second.p90_ms
+				    << ", p99 " << base->second.p99_ms << ')' << std::endl;
+				++regressions;
+			}
+			else
+			{
+				std::cout << " OK" << std::endl;
+			}
+		}
 
-	GLuint light_id_ = 0; ///< shader uniform
-};
+		unloadWorld(world);
+	}
+
+	if (options.write_baseline)
+		return writeBaseline(options.baseline_path.c_str(), results) ? 0 : 1;
+
+	std::cout << results.size() << " cases, " << regressions << " slower, "
+	    << missing << " without baseline" << std::endl;
+	return regressions ? 5 : 0;
+}
 
 int main(int argc, char **argv)
 {
@@ -408,10 +435,103 @@ int main(int argc, char **argv)
 		return 1;
 	}
 
-	const char *obj_path = "../cube.obj";
-	if (argc > 1)
+	std::vector<ManifestEntry> models;
+	unsigned bench_frames = 0; ///< run this many frames, then report
+	std::size_t budget_mb = 256; ///< GPU memory for meshes and textures
+	const char *cache_dir = "."; ///< binary mesh cache
+	const char *trace_path = nullptr; ///< write Chrome trace JSON here
+	bool show_overlay = false; ///< profile text on screen (toggle with F1)
+	WorldOptions world_options;
+	const char *record_path = nullptr; ///< record the camera to this file
+	const char *replay_path = nullptr; ///< camera from this file
+	const char *suite_path = nullptr; ///< regression run
+	RegressionOptions regression_options;
+	for (int i = 1; i < argc; ++i)
 	{
-		obj_path = argv[1];
+		if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc)
+		{
+			bench_frames = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+		{
+			budget_mb = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+		{
+			cache_dir = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			trace_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--overlay") == 0)
+		{
+			show_overlay = true;
+		}
+		else if (std::strcmp(argv[i], "--gpu-driven") == 0)
+		{
+			world_options.gpu_driven = true;
+		}
+		else if (std::strcmp(argv[i], "--no-shadows") == 0)
+		{
+			world_options.use_shadows = false;
+		}
+		else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			record_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replay_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--timestep") == 0 && i + 1 < argc)
+		{
+			regression_options.timestep = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--regress") == 0 && i + 1 < argc)
+		{
+			suite_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+		{
+			regression_options.baseline_path = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--write-baseline") == 0)
+		{
+			regression_options.write_baseline = true;
+		}
+		else if (std::strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc)
+		{
+			regression_options.tolerance_pct = std::atof(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--manifest") == 0 && i + 1 < argc)
+		{
+			if (!readManifest(argv[++i], models))
+				return 1;
+		}
+		else
+		{
+			ManifestEntry entry;
+			entry.path = argv[i];
+			entry.placement = glm::mat4(1.0f);
+			models.push_back(entry);
+		}
+	}
+	if (models.empty())
+	{
+		ManifestEntry entry;
+		entry.path = "../cube.obj";
+		entry.placement = glm::mat4(1.0f);
+		models.push_back(entry);
+	}
+
+	RegressionSuite suite;
+	if (suite_path)
+	{
+		if (!readRegressionSuite(suite_path, suite))
+			return 1;
+		if (regression_options.baseline_path.empty())
+			regression_options.baseline_path = std::string(suite_path) + ".baseline";
 	}
 
 	/*
@@ -444,8 +564,21 @@ int main(int argc, char **argv)
 		return 3;
 	}
 
+	profiler().init();
+	if (trace_path)
+		profiler().startTrace(256 * 1024);
+
 	Controls *controls = new Controls(window);
 
+	TextOverlay *overlay = new TextOverlay;
+	if (!overlay->init())
+	{
+		std::cerr << "No profile overlay" << std::endl;
+		delete overlay;
+		overlay = nullptr;
+	}
+	bool overlay_key_down = false;
+
 	// make sure we get all key presses
 	glfwSetInputMode(window, GLFW_STICKY_KEYS, GL_TRUE);
 	// hide mouse cursor
@@ -460,30 +593,166 @@ int main(int argc, char **argv)
 	glDepthFunc(GL_LESS);
 	glEnable(GL_CULL_FACE);
 
-	Scene main_scene;
-	if (!main_scene.load(obj_path))
+	ResidencyManager *resources = new ResidencyManager(budget_mb * 1024 * 1024, cache_dir);
+
+	if (bench_frames || replay_path || suite_path)
+	{
+		// don't wait for vsync
+		glfwSwapInterval(0);
+	}
+
+	if (suite_path)
+	{
+		int result = runRegression(suite, regression_options, world_options,
+		    window, *controls, *resources);
+
+		if (trace_path && !profiler().writeTrace(trace_path))
+		{
+			std::cerr << "Trace was not written to " << trace_path << std::endl;
+			if (result == 0)
+				result = 1;
+		}
+
+		delete resources;
+		delete overlay;
+		profiler().shutdown();
+		delete controls;
+		glfwTerminate();
+		return result;
+	}
+
+	World world;
+	if (!loadWorld(world, models, *resources, world_options))
 	{
 		return 4;
 	}
 
+	if (replay_path && !controls->startReplay(replay_path, regression_options.timestep))
+	{
+		return 4;
+	}
+	if (record_path)
+		controls->startRecording();
+
+	// frame times of the replay
+	std::vector<float> replay_ms;
+	replay_ms.reserve(controls->replayFrames());
+	double last_time = glfwGetTime();
+
+	// the first frame sizes the frame arena, don't count it
+	unsigned frame = 0;
+	double bench_start = 0;
+	std::size_t bench_allocs = 0;
+
 	do
 	{
-		// erase screen before drawing
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (bench_frames && frame == 1)
+		{
+			glFinish();
+			bench_start = glfwGetTime();
+			bench_allocs = allocationCount();
+		}
+
+		profiler().beginFrame();
+		{
+			PROFILE_SCOPE("frame");
 
-		main_scene.render(controls);
+			drawWorld(world, *controls, *resources, window);
+
+			if (show_overlay && overlay)
+			{
+				PROFILE_SCOPE("overlay");
+				int width = 0, height = 0;
+				glfwGetFramebufferSize(window, &width, &height);
+				profileOverlay(*overlay);
+				overlay->render(width, height);
+			}
+		}
+		profiler().endFrame();
 
 		// done drawing! swap buffer to front
 		glfwSwapBuffers(window);
 		glfwPollEvents(); // get events
 
+		// F1 toggles the profile overlay
+		const bool overlay_key = glfwGetKey(window, GLFW_KEY_F1) == GLFW_PRESS;
+		if (overlay_key && !overlay_key_down)
+			show_overlay = !show_overlay;
+		overlay_key_down = overlay_key;
+
+		const double now = glfwGetTime();
+		if (controls->replaying() && frame >= WARMUP_FRAMES)
+			replay_ms.push_back(float((now - last_time) * 1000));
+		last_time = now;
+
+		++frame;
+		if (bench_frames && frame > bench_frames)
+			break;
+		if (controls->replayDone())
+			break;
+
 		// while not escape key, or close window button
 	} while (glfwGetKey(window, GLFW_KEY_ESCAPE) != GLFW_PRESS &&
 	         glfwWindowShouldClose(window) == 0);
 
+	if (bench_frames && frame > 1)
+	{
+		glFinish();
+		const unsigned n = frame - 1;
+		const double elapsed = glfwGetTime() - bench_start;
+		const std::size_t allocs = allocationCount() - bench_allocs;
+		std::cout << "Frames: " << n << std::endl;
+		std::cout << "Avg frame ms: " << elapsed * 1000 / n << std::endl;
+		std::cout << "Allocations/frame: " << double(allocs) / n << std::endl;
+		std::cout << "GPU MB: " << resources->gpuBytes() / (1024 * 1024)
+		    << " (budget " << budget_mb << ')' << std::endl;
+		std::cout << "Evictions/Reloads: " << resources->evictions()
+		    << '/' << resources->reloads() << std::endl;
+		if (world.shadows)
+		{
+			std::cout << "Cascade renders:";
+			for (unsigned c = 0; c < CascadedShadows::NUM_CASCADES; ++c)
+				std::cout << ' ' << world.shadows->renders(c);
+			std::cout << std::endl;
+		}
+
+		const Profiler &prof = profiler();
+		for (unsigned i = 0; i < prof.numStats(); ++i)
+		{
+			const Profiler::Stat &st = prof.stat(i);
+			for (unsigned j = 0; j < st.depth; ++j)
+				std::cout << "   ";
+			std::cout << st.name << ": cpu " << st.avg_cpu_ms
+			    << " ms, gpu " << st.avg_gpu_ms << " ms" << std::endl;
+		}
+	}
+
+	if (!replay_ms.empty())
+	{
+		std::cout << "Replay: ";
+		printFrameStats(frameStats(replay_ms));
+		std::cout << std::endl;
+	}
 
+	int result = 0;
+	if (record_path && !controls->stopRecording(record_path))
+	{
+		std::cerr << "Camera recording was not written to " << record_path << std::endl;
+		result = 1;
+	}
+
+	if (trace_path && !profiler().writeTrace(trace_path))
+	{
+		std::cerr << "Trace was not written to " << trace_path << std::endl;
+		result = 1;
+	}
+
+	unloadWorld(world);
+	delete resources;
+	delete overlay;
+	profiler().shutdown();
 	delete controls;
 	glfwTerminate();
-	return 0;
+	return result;
 }
 
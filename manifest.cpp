@@ -0,0 +1,51 @@
+#include "manifest.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool readManifest(const char *manifest_path, std::vector<ManifestEntry> &entries)
+{
+	std::ifstream in(manifest_path, std::ios::in);
+	if (!in.is_open())
+	{
+		std::cerr << "Failed to open manifest " << manifest_path << std::endl;
+		return false;
+	}
+
+	// directory of the manifest (including the slash)
+	std::string dir(manifest_path);
+	const std::string::size_type slash = dir.find_last_of("/\\");
+	dir = slash == std::string::npos ? std::string() : dir.substr(0, slash + 1);
+
+	std::string line;
+	unsigned line_num = 0;
+	while (std::getline(in, line))
+	{
+		++line_num;
+
+		std::istringstream str(line);
+		std::string path;
+		if (!(str >> path) || path[0] == '#')
+			continue;
+
+		glm::vec3 pos(0.f, 0.f, 0.f);
+		float scale = 1.f;
+		if (str >> pos.x)
+		{
+			if (!(str >> pos.y >> pos.z))
+			{
+				std::cerr << manifest_path << ':' << line_num << ": expected x y z" << std::endl;
+				return false;
+			}
+			str >> scale;
+		}
+
+		ManifestEntry entry;
+		entry.path = path[0] == '/' ? path : dir + path;
+		entry.placement = glm::scale(glm::translate(glm::mat4(1.0f), pos), glm::vec3(scale));
+		entries.push_back(entry);
+	}
+
+	return true;
+}
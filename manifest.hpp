@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+/// One model to load, and where to put it
+struct ManifestEntry
+{
+	std::string path; ///< model file
+	glm::mat4 placement; ///< model to world
+};
+
+/// Read a scene manifest, a text file with one model per line:
+///    path [x y z [scale]]
+/// Blank lines and lines starting with '#' are skipped.
+/// Relative paths are relative to the manifest.
+bool readManifest(const char *manifest_path, std::vector<ManifestEntry> &entries);
@@ -0,0 +1,320 @@
+#include "mesh.hpp"
+#include "arena.hpp"
+#include "frustum.hpp"
+#include "hash.hpp"
+#include "meshlet.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+
+/// binary cache header
+struct CacheHeader
+{
+	char magic[4]; ///< "YYMC"
+	std::uint32_t version;
+	std::uint32_t num_vertices;
+	std::uint32_t num_indices;
+	std::uint32_t num_meshlets;
+};
+
+const std::uint32_t CACHE_VERSION = 2;
+
+template<typename T>
+bool writeArray(FILE *file, const std::vector<T> &v)
+{
+	return v.empty() || fwrite(&v[0], sizeof(T), v.size(), file) == v.size();
+}
+
+template<typename T>
+std::size_t arrayBytes(const std::vector<T> &v)
+{
+	return v.size() * sizeof(T);
+}
+
+template<typename T>
+bool readArray(FILE *file, std::vector<T> &v, std::size_t count)
+{
+	v.resize(count);
+	return count == 0 || fread(&v[0], sizeof(T), count, file) == count;
+}
+
+}
+
+//----------------------------------------------------------------------------
+void MeshData::clear()
+{
+	vertices.clear();
+	uvs.clear();
+	normals.clear();
+	faces.clear();
+	meshlets.clear();
+}
+
+std::uint64_t MeshData::hash() const
+{
+	std::uint64_t h = hashBytes(vertices.data(), vertices.size() * sizeof(vertices[0]));
+	h = hashBytes(uvs.data(), uvs.size() * sizeof(uvs[0]), h);
+	h = hashBytes(normals.data(), normals.size() * sizeof(normals[0]), h);
+	h = hashBytes(faces.data(), faces.size() * sizeof(faces[0]), h);
+	return hashBytes(meshlets.data(), meshlets.size() * sizeof(meshlets[0]), h);
+}
+
+bool writeMeshCache(const std::string &path, const MeshData &data)
+{
+	FILE *file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		std::cerr << path << " could not be opened for writing." << std::endl;
+		return false;
+	}
+
+	CacheHeader hdr;
+	std::memcpy(hdr.magic, "YYMC", 4);
+	hdr.version = CACHE_VERSION;
+	hdr.num_vertices = data.vertices.size();
+	hdr.num_indices = data.faces.size();
+	hdr.num_meshlets = data.meshlets.size();
+
+	const bool ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1
+	    && writeArray(file, data.vertices)
+	    && writeArray(file, data.uvs)
+	    && writeArray(file, data.normals)
+	    && writeArray(file, data.faces)
+	    && writeArray(file, data.meshlets);
+
+	fclose(file);
+	if (!ok)
+	{
+		std::cerr << "Failed writing " << path << std::endl;
+		std::remove(path.c_str());
+	}
+	return ok;
+}
+
+bool readMeshCache(const std::string &path, MeshData &data)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+	{
+		std::cerr << path << " could not be opened." << std::endl;
+		return false;
+	}
+
+	CacheHeader hdr;
+	if (fread(&hdr, sizeof(hdr), 1, file) != 1 ||
+	    std::memcmp(hdr.magic, "YYMC", 4) != 0 ||
+	    hdr.version != CACHE_VERSION)
+	{
+		std::cerr << path << " is not a mesh cache file." << std::endl;
+		fclose(file);
+		return false;
+	}
+
+	const bool ok = readArray(file, data.vertices, hdr.num_vertices)
+	    && readArray(file, data.uvs, hdr.num_vertices)
+	    && readArray(file, data.normals, hdr.num_vertices)
+	    && readArray(file, data.faces, hdr.num_indices)
+	    && readArray(file, data.meshlets, hdr.num_meshlets);
+
+	fclose(file);
+	if (!ok)
+		std::cerr << path << " is truncated." << std::endl;
+	return ok;
+}
+
+bool checkMeshCache(const std::string &path, const MeshData &data)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+
+	// a crash while writing leaves a short file with the right name
+	CacheHeader hdr;
+	bool ok = fread(&hdr, sizeof(hdr), 1, file) == 1 &&
+	    std::memcmp(hdr.magic, "YYMC", 4) == 0 &&
+	    hdr.version == CACHE_VERSION &&
+	    hdr.num_vertices == data.vertices.size() &&
+	    hdr.num_indices == data.faces.size() &&
+	    hdr.num_meshlets == data.meshlets.size();
+
+	const std::size_t size = sizeof(hdr) + arrayBytes(data.vertices) + arrayBytes(data.uvs) +
+	    arrayBytes(data.normals) + arrayBytes(data.faces) + arrayBytes(data.meshlets);
+	ok = ok && fseek(file, 0, SEEK_END) == 0 && ftell(file) == long(size);
+
+	fclose(file);
+	return ok;
+}
+
+//----------------------------------------------------------------------------
+Mesh::Mesh(std::uint64_t hash, const std::string &cache_path)
+: hash_(hash)
+, cache_path_(cache_path)
+{
+}
+
+Mesh::~Mesh()
+{
+	evict();
+}
+
+void Mesh::upload(const MeshData &data)
+{
+	evict();
+
+	if (!data.vertices.empty())
+	{
+		bounds_min_ = bounds_max_ = data.vertices[0];
+		for (const auto &v : data.vertices)
+		{
+			bounds_min_ = glm::min(bounds_min_, v);
+			bounds_max_ = glm::max(bounds_max_, v);
+		}
+	}
+
+	glGenBuffers(1, &vertex_buffer_);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(glm::vec3), data.vertices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &uv_buffer_);
+	glBindBuffer(GL_ARRAY_BUFFER, uv_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, data.uvs.size() * sizeof(glm::vec2), data.uvs.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &normal_buffer_);
+	glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, data.normals.size() * sizeof(glm::vec3), data.normals.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &face_buffer_);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, face_buffer_);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.faces.size() * sizeof(data.faces[0]), data.faces.data(), GL_STATIC_DRAW);
+
+	num_faces_ = data.faces.size();
+	meshlets_ = data.meshlets;
+	gpu_bytes_ = data.vertices.size() * sizeof(glm::vec3)
+	    + data.uvs.size() * sizeof(glm::vec2)
+	    + data.normals.size() * sizeof(glm::vec3)
+	    + data.faces.size() * sizeof(data.faces[0]);
+}
+
+void Mesh::evict()
+{
+	if (!resident())
+		return;
+
+	glDeleteBuffers(1, &vertex_buffer_);
+	glDeleteBuffers(1, &uv_buffer_);
+	glDeleteBuffers(1, &normal_buffer_);
+	glDeleteBuffers(1, &face_buffer_);
+	vertex_buffer_ = uv_buffer_ = normal_buffer_ = face_buffer_ = 0;
+	gpu_bytes_ = 0;
+}
+
+void Mesh::render(const glm::mat4 &model, const Frustum &frustum, const glm::vec4 &view,
+    Arena &scratch) const
+{
+	// attribute 0 - vertex data
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	glVertexAttribPointer(
+		0,                  // attribute 0. No particular reason for 0, but must match the layout in the shader.
+		3,                  // size
+		GL_FLOAT,           // type
+		GL_FALSE,           // normalized?
+		0,                  // stride
+		(void*)0            // array buffer offset
+	);
+
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, uv_buffer_);
+	glVertexAttribPointer(
+		1,                                // attribute. No particular reason for 1, but must match the layout in the shader.
+		2,                                // size
+		GL_FLOAT,                         // type
+		GL_FALSE,                         // normalized?
+		0,                                // stride
+		(void*)0                          // array buffer offset
+	);
+
+	glEnableVertexAttribArray(2);
+	glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_);
+	glVertexAttribPointer(
+		2,                                // attribute
+		3,                                // size
+		GL_FLOAT,                         // type
+		GL_FALSE,                         // normalized?
+		0,                                // stride
+		(void*)0                          // array buffer offset
+	);
+
+	// draw the triangles!
+	drawMeshlets(model, frustum, view, scratch);
+
+	// done
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+	glDisableVertexAttribArray(2);
+}
+
+void Mesh::renderDepth(const glm::mat4 &model, const Frustum &frustum, const glm::vec4 &view,
+    Arena &scratch) const
+{
+	// positions only
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	drawMeshlets(model, frustum, view, scratch);
+
+	glDisableVertexAttribArray(0);
+}
+
+void Mesh::drawMeshlets(const glm::mat4 &model, const Frustum &frustum, const glm::vec4 &view,
+    Arena &scratch) const
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, face_buffer_);
+
+	// nothing to gain from one meshlet (the mesh passed the box test)
+	if (meshlets_.size() <= 1)
+	{
+		glDrawElements(GL_TRIANGLES, num_faces_, GL_UNSIGNED_INT, (void*)0);
+		return;
+	}
+
+	// frustum and view in model space, so the meshlets don't have to move
+	// (assumes no non-uniform scale, like the normals)
+	const Frustum local_frustum = transformFrustum(frustum, model);
+	glm::vec4 local_view = glm::inverse(model) * view;
+	if (view.w == 0.f)
+		local_view = glm::vec4(glm::normalize(glm::vec3(local_view)), 0.f);
+
+	// one range per run of visible meshlets (they are in index order)
+	const unsigned n = meshlets_.size();
+	GLsizei *counts = scratch.allocArray<GLsizei>(n);
+	const void **offsets = scratch.allocArray<const void*>(n);
+	unsigned num_ranges = 0;
+	std::uint32_t range_end = ~0u;
+
+	for (const auto &m : meshlets_)
+	{
+		if (!isSphereVisible(local_frustum, m.center, m.radius) ||
+		    isMeshletBackfacing(m, local_view))
+			continue;
+
+		if (m.first_index == range_end)
+		{
+			counts[num_ranges - 1] += m.num_indices;
+		}
+		else
+		{
+			counts[num_ranges] = m.num_indices;
+			offsets[num_ranges] = (const void*)(std::size_t(m.first_index) * sizeof(unsigned));
+			++num_ranges;
+		}
+		range_end = m.first_index + m.num_indices;
+	}
+
+	if (num_ranges != 0)
+		glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, offsets, num_ranges);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Arena;
+struct Frustum;
+
+//----------------------------------------------------------------------------
+/// A small cluster of a mesh's triangles, culled on its own (see meshlet.hpp)
+struct Meshlet
+{
+	glm::vec3 center; ///< bounding sphere (model space)
+	float radius;
+	glm::vec3 cone_axis; ///< average facing of the triangles
+	float cone_cutoff; ///< sine of the normal cone's half angle (> 1 for no cone)
+	std::uint32_t first_index; ///< into the faces
+	std::uint32_t num_indices;
+};
+
+/// CPU side copy of one mesh (what goes into the VBOs)
+struct MeshData
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec2> uvs;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned> faces; ///< 3 indexes per triangle
+	std::vector<Meshlet> meshlets; ///< cover the faces, in order
+
+	void clear();
+
+	/// content hash (used to share meshes between models)
+	std::uint64_t hash() const;
+};
+
+/// binary cache file for one mesh
+bool writeMeshCache(const std::string &path, const MeshData &data);
+bool readMeshCache(const std::string &path, MeshData &data);
+/// is there a complete cache file for data at path (quietly false if not)
+bool checkMeshCache(const std::string &path, const MeshData &data);
+
+//----------------------------------------------------------------------------
+/// One mesh in the scene
+/// Owned by the ResidencyManager, which may drop the GPU buffers (evict)
+/// and later reload them from the binary cache
+class Mesh
+{
+public:
+	Mesh(std::uint64_t hash, const std::string &cache_path);
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	~Mesh();
+
+	/// create the GPU buffers (and model space bounds)
+	void upload(const MeshData &data);
+
+	/// delete the GPU buffers
+	void evict();
+
+	bool resident() const { return face_buffer_ != 0; }
+
+	/// draw the meshlets inside the frustum which don't all face away from view
+	/// view is the camera position (w = 1), or the direction of an orthographic
+	/// view (w = 0), in world space. The draw ranges go in scratch.
+	void render(const glm::mat4 &model, const Frustum &frustum, const glm::vec4 &view,
+	    Arena &scratch) const;
+	/// positions only (shadow maps)
+	void renderDepth(const glm::mat4 &model, const Frustum &frustum, const glm::vec4 &view,
+	    Arena &scratch) const;
+
+	std::uint64_t hash() const { return hash_; }
+	const std::string& cachePath() const { return cache_path_; }
+
+	/// bytes used in GPU memory (when resident)
+	std::size_t gpuBytes() const { return gpu_bytes_; }
+
+	const glm::vec3& boundsMin() const { return bounds_min_; }
+	const glm::vec3& boundsMax() const { return bounds_max_; }
+
+	unsigned numMeshlets() const { return meshlets_.size(); }
+
+protected: // methods
+	/// cull the meshlets, and draw the rest (attributes are set up)
+	void drawMeshlets(const glm::mat4 &model, const Frustum &frustum, const glm::vec4 &view,
+	    Arena &scratch) const;
+
+protected: // data
+	friend class ResidencyManager;
+	unsigned refs_ = 0; ///< scenes using this mesh
+	unsigned last_visible_ = 0; ///< frame number
+	bool cached_ = false; ///< binary cache file is good (so it can be evicted)
+
+	std::uint64_t hash_ = 0; ///< content hash
+	std::string cache_path_; ///< binary cache file
+
+	GLuint vertex_buffer_ = 0; ///< vertex buffer id
+	GLuint uv_buffer_ = 0;     ///< uv buffer id
+	GLuint normal_buffer_ = 0; ///<  normal buffer id
+	GLuint face_buffer_ = 0;   ///< faces hold indexes of vertexes
+	unsigned num_faces_ = 0;
+	std::size_t gpu_bytes_ = 0;
+
+	glm::vec3 bounds_min_ = glm::vec3(0.f); ///< model space
+	glm::vec3 bounds_max_ = glm::vec3(0.f); ///< model space
+	std::vector<Meshlet> meshlets_; ///< (kept when evicted)
+};
@@ -0,0 +1,202 @@
+#include "meshlet.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+/// the cone test can't cull a meshlet with this cutoff
+const float NO_CONE = 2.f;
+
+/// bounding sphere of the meshlet's vertexes
+void meshletSphere(const MeshData &data, Meshlet &m)
+{
+	const unsigned *idx = &data.faces[m.first_index];
+
+	glm::vec3 box_min = data.vertices[idx[0]];
+	glm::vec3 box_max = box_min;
+	for (unsigned i = 0; i < m.num_indices; ++i)
+	{
+		box_min = glm::min(box_min, data.vertices[idx[i]]);
+		box_max = glm::max(box_max, data.vertices[idx[i]]);
+	}
+
+	m.center = (box_min + box_max) * 0.5f;
+	m.radius = 0.f;
+	for (unsigned i = 0; i < m.num_indices; ++i)
+		m.radius = std::max(m.radius, glm::length(data.vertices[idx[i]] - m.center));
+}
+
+/// normal cone of the meshlet's triangles
+void meshletCone(const MeshData &data, Meshlet &m)
+{
+	const unsigned *idx = &data.faces[m.first_index];
+
+	// the axis is the average facing (counter clockwise is the front)
+	glm::vec3 sum(0.f);
+	for (unsigned i = 0; i < m.num_indices; i += 3)
+	{
+		const glm::vec3 &a = data.vertices[idx[i]];
+		const glm::vec3 n = glm::cross(data.vertices[idx[i + 1]] - a, data.vertices[idx[i + 2]] - a);
+		const float len = glm::length(n);
+		if (len > 0.f)
+			sum += n / len;
+	}
+
+	m.cone_cutoff = NO_CONE;
+	m.cone_axis = glm::vec3(0.f, 0.f, 1.f);
+	const float sum_len = glm::length(sum);
+	if (sum_len < 1e-6f)
+		return;
+	m.cone_axis = sum / sum_len;
+
+	float min_dot = 1.f;
+	for (unsigned i = 0; i < m.num_indices; i += 3)
+	{
+		const glm::vec3 &a = data.vertices[idx[i]];
+		const glm::vec3 n = glm::cross(data.vertices[idx[i + 1]] - a, data.vertices[idx[i + 2]] - a);
+		const float len = glm::length(n);
+		if (len > 0.f)
+			min_dot = std::min(min_dot, glm::dot(n / len, m.cone_axis));
+	}
+
+	// a half angle of 90 degrees or more can't all face away
+	if (min_dot > 0.f)
+	{
+		// sine of the half angle, rounded up
+		m.cone_cutoff = std::min(1.f, std::sqrt(1.f - min_dot * min_dot) + 1e-3f);
+	}
+}
+
+}
+
+void buildMeshlets(MeshData &data)
+{
+	// not all triangles (points or lines)
+	if (data.faces.size() % 3 != 0)
+	{
+		buildSingleMeshlet(data);
+		return;
+	}
+
+	data.meshlets.clear();
+	const unsigned num_tris = data.faces.size() / 3;
+	const unsigned num_indices = num_tris * 3;
+	if (num_tris == 0)
+		return;
+
+	// triangles using each vertex
+	const unsigned num_verts = data.vertices.size();
+	std::vector<unsigned> vert_first(num_verts + 1, 0);
+	for (unsigned i = 0; i < num_indices; ++i)
+		++vert_first[data.faces[i] + 1];
+	for (unsigned v = 0; v < num_verts; ++v)
+		vert_first[v + 1] += vert_first[v];
+
+	std::vector<unsigned> vert_tris(num_indices);
+	{
+		std::vector<unsigned> fill(vert_first.begin(), vert_first.end() - 1);
+		for (unsigned t = 0; t < num_tris; ++t)
+		{
+			for (unsigned k = 0; k < 3; ++k)
+				vert_tris[fill[data.faces[t * 3 + k]]++] = t;
+		}
+	}
+
+	std::vector<unsigned> faces;
+	faces.reserve(num_indices);
+	std::vector<bool> used(num_tris, false);
+	std::vector<unsigned> vert_meshlet(num_verts, ~0u); ///< last meshlet using the vertex
+	std::vector<unsigned> candidates;
+
+	unsigned seed = 0;
+	while (faces.size() < num_indices)
+	{
+		while (used[seed])
+			++seed;
+
+		const unsigned id = data.meshlets.size();
+		Meshlet m = Meshlet();
+		m.first_index = faces.size();
+
+		unsigned num_meshlet_verts = 0;
+		unsigned num_meshlet_tris = 0;
+
+		candidates.clear();
+		candidates.push_back(seed);
+		for (std::size_t c = 0; c < candidates.size(); ++c)
+		{
+			const unsigned t = candidates[c];
+			if (used[t])
+				continue;
+
+			const unsigned *tri = &data.faces[t * 3];
+			unsigned new_verts = 0;
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				const bool repeat = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+				if (vert_meshlet[tri[k]] != id && !repeat)
+					++new_verts;
+			}
+			if (num_meshlet_verts + new_verts > MESHLET_MAX_VERTICES)
+				continue;
+
+			used[t] = true;
+			num_meshlet_verts += new_verts;
+			++num_meshlet_tris;
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				vert_meshlet[tri[k]] = id;
+				faces.push_back(tri[k]);
+			}
+
+			if (num_meshlet_tris == MESHLET_MAX_TRIANGLES)
+				break;
+
+			// neighbors next, so the meshlet stays compact
+			for (unsigned k = 0; k < 3; ++k)
+			{
+				for (unsigned i = vert_first[tri[k]]; i < vert_first[tri[k] + 1]; ++i)
+				{
+					if (!used[vert_tris[i]])
+						candidates.push_back(vert_tris[i]);
+				}
+			}
+		}
+
+		m.num_indices = faces.size() - m.first_index;
+		data.meshlets.push_back(m);
+	}
+
+	data.faces.swap(faces);
+	for (auto &m : data.meshlets)
+	{
+		meshletSphere(data, m);
+		meshletCone(data, m);
+	}
+}
+
+void buildSingleMeshlet(MeshData &data)
+{
+	data.meshlets.clear();
+	if (data.faces.empty())
+		return;
+
+	Meshlet m = Meshlet();
+	m.first_index = 0;
+	m.num_indices = data.faces.size();
+	meshletSphere(data, m);
+	m.cone_axis = glm::vec3(0.f, 0.f, 1.f);
+	m.cone_cutoff = NO_CONE;
+	data.meshlets.push_back(m);
+}
+
+bool isMeshletBackfacing(const Meshlet &m, const glm::vec4 &view)
+{
+	if (view.w == 0.f)
+		return glm::dot(glm::vec3(view), m.cone_axis) >= m.cone_cutoff;
+
+	// every point of the sphere sees every normal of the cone from behind
+	const glm::vec3 d = m.center - glm::vec3(view);
+	return glm::dot(d, m.cone_axis) >= m.cone_cutoff * glm::length(d) + m.radius * (1.f + m.cone_cutoff);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "mesh.hpp"
+
+/// limits of one meshlet
+const unsigned MESHLET_MAX_VERTICES = 64;
+const unsigned MESHLET_MAX_TRIANGLES = 124;
+
+/// Split a mesh into meshlets: triangles grow out from a seed through shared
+/// vertexes until the vertex or triangle limit. The faces are reordered so
+/// each meshlet is one range of them, and data.meshlets covers them all.
+/// Faces which aren't all triangles get buildSingleMeshlet.
+void buildMeshlets(MeshData &data);
+
+/// one meshlet of the whole mesh, without a normal cone (for points and lines)
+void buildSingleMeshlet(MeshData &data);
+
+/// does every triangle of the meshlet face away from view
+/// view is the camera position (w = 1), or the direction of an orthographic
+/// view (w = 0, normalized), in model space
+bool isMeshletBackfacing(const Meshlet &m, const glm::vec4 &view);
@@ -0,0 +1,121 @@
+#include "overlay.hpp"
+#include "loadShaders.hpp"
+
+namespace
+{
+
+const unsigned GLYPH_W = 3;
+const unsigned GLYPH_H = 5;
+
+/// font for ASCII ' ' to '_', one octal digit per row (top first, high bit left)
+const unsigned short FONT[64] =
+{
+	000000, 022202, 055000, 057575, 000000, 051245, 000000, 022000, // ' ' to '''
+	012221, 042224, 005250, 002720, 000024, 000700, 000002, 011244, // '(' to '/'
+	075557, 026227, 071747, 071717, 055711, 074717, 074757, 071111, // '0' to '7'
+	075757, 075717, 002020, 002024, 012421, 007070, 042124, 071202, // '8' to '?'
+	000000, 025755, 065656, 034443, 065556, 074647, 074644, 034553, // '@' to 'G'
+	055755, 072227, 011152, 055655, 044447, 057755, 065555, 025552, // 'H' to 'O'
+	065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, // 'P' to 'W'
+	055255, 055222, 071247, 064446, 044211, 031113, 025000, 000007, // 'X' to '_'
+};
+
+unsigned glyph(char c)
+{
+	if (c >= 'a' && c <= 'z')
+		c = c - 'a' + 'A';
+	if (c < ' ' || c > '_')
+		return 0;
+	return FONT[c - ' '];
+}
+
+}
+
+TextOverlay::~TextOverlay()
+{
+	glDeleteBuffers(1, &vertex_buffer_);
+	glDeleteProgram(program_id_);
+}
+
+bool TextOverlay::init()
+{
+	program_id_ = loadShaders("../overlay.vert.glsl", "../overlay.frag.glsl");
+	if (!program_id_)
+		return false;
+
+	screen_size_id_ = glGetUniformLocation(program_id_, "screen_size");
+	color_id_ = glGetUniformLocation(program_id_, "text_color");
+
+	glGenBuffers(1, &vertex_buffer_);
+	vertices_.reserve(MAX_VERTICES);
+	return true;
+}
+
+void TextOverlay::clear()
+{
+	vertices_.clear();
+}
+
+void TextOverlay::print(unsigned column, unsigned row, const char *text)
+{
+	// one cell has a pixel of space right and below
+	const float cell_w = (GLYPH_W + 1) * SCALE;
+	const float cell_h = (GLYPH_H + 1) * SCALE;
+
+	for (; *text; ++text, ++column)
+	{
+		const unsigned bits = glyph(*text);
+		const glm::vec2 origin((column + 1) * cell_w, (row + 1) * cell_h);
+
+		for (unsigned y = 0; y < GLYPH_H; ++y)
+		{
+			for (unsigned x = 0; x < GLYPH_W; ++x)
+			{
+				const unsigned bit = (GLYPH_H - 1 - y) * GLYPH_W + (GLYPH_W - 1 - x);
+				if (!(bits & (1u << bit)))
+					continue;
+
+				// stay inside the reserve (no allocation)
+				if (vertices_.size() + 6 > vertices_.capacity())
+					return;
+
+				const glm::vec2 a = origin + glm::vec2(x * SCALE, y * SCALE);
+				const glm::vec2 b = a + glm::vec2(SCALE, 0);
+				const glm::vec2 c = a + glm::vec2(0, SCALE);
+				const glm::vec2 d = a + glm::vec2(SCALE, SCALE);
+				vertices_.push_back(a);
+				vertices_.push_back(c);
+				vertices_.push_back(b);
+				vertices_.push_back(b);
+				vertices_.push_back(c);
+				vertices_.push_back(d);
+			}
+		}
+	}
+}
+
+void TextOverlay::render(int width, int height)
+{
+	if (vertices_.empty())
+		return;
+
+	glUseProgram(program_id_);
+	glUniform2f(screen_size_id_, float(width), float(height));
+	glUniform3f(color_id_, 1.0f, 1.0f, 0.0f);
+
+	// orphan last frame's buffer
+	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, vertices_.size() * sizeof(glm::vec2), vertices_.data(), GL_STREAM_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	// always on top, and winding doesn't matter
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDrawArrays(GL_TRIANGLES, 0, vertices_.size());
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+
+	glDisableVertexAttribArray(0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Ouput data
+out vec3 color;
+
+uniform vec3 text_color;
+
+void main()
+{
+	color = text_color;
+}
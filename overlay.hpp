@@ -0,0 +1,39 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/// Text drawn over the scene, with a tiny built in 3x5 pixel font
+/// (upper case, digits and some punctuation)
+class TextOverlay
+{
+public:
+	TextOverlay() = default;
+	TextOverlay(const TextOverlay&) = delete;
+	TextOverlay& operator=(const TextOverlay&) = delete;
+	~TextOverlay();
+
+	/// call with a current GL context
+	bool init();
+
+	/// remove all text
+	void clear();
+
+	/// add text at a character cell
+	void print(unsigned column, unsigned row, const char *text);
+
+	/// draw the text on top of whatever is in the framebuffer
+	void render(int width, int height);
+
+private:
+	static constexpr unsigned SCALE = 2; ///< screen pixels per font pixel
+	static constexpr unsigned MAX_VERTICES = 64 * 1024;
+
+	std::vector<glm::vec2> vertices_; ///< two triangles per lit font pixel
+
+	GLuint program_id_ = 0;
+	GLuint vertex_buffer_ = 0;
+	GLuint screen_size_id_ = 0; ///< shader uniform
+	GLuint color_id_ = 0; ///< shader uniform
+};
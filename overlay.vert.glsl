@@ -0,0 +1,13 @@
+#version 330 core
+
+// pixel position, (0,0) is the top left
+layout(location = 0) in vec2 vertex_position_screen;
+
+// framebuffer size in pixels
+uniform vec2 screen_size;
+
+void main()
+{
+	vec2 ndc = vertex_position_screen / screen_size * 2.0 - 1.0;
+	gl_Position = vec4(ndc.x, -ndc.y, 0, 1);
+}
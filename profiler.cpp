@@ -0,0 +1,281 @@
+#include "profiler.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+namespace
+{
+
+/// marker handles for markers outside of a frame
+const unsigned LOAD_MARKER = 0x80000000u;
+
+/// weight of the newest frame in the averages
+const double SMOOTHING = 0.1;
+
+}
+
+Profiler& profiler()
+{
+	static Profiler p;
+	return p;
+}
+
+double Profiler::now() const
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count() - cpu_base_;
+}
+
+void Profiler::init()
+{
+	cpu_base_ = 0;
+	cpu_base_ = now();
+
+	// timestamps are core in 3.3
+	gpu_timers_ = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+	debug_groups_ = GLEW_KHR_debug;
+
+	if (gpu_timers_)
+	{
+		for (auto &s : slots_)
+			glGenQueries(MAX_MARKERS * 2, s.queries);
+
+		glGetInteger64v(GL_TIMESTAMP, &gpu_base_);
+	}
+	else
+	{
+		std::cerr << "No timer queries, GPU times will be 0" << std::endl;
+	}
+}
+
+void Profiler::shutdown()
+{
+	if (gpu_timers_)
+	{
+		for (auto &s : slots_)
+		{
+			glDeleteQueries(MAX_MARKERS * 2, s.queries);
+			s.pending = false;
+		}
+	}
+	gpu_timers_ = false;
+	debug_groups_ = false;
+}
+
+void Profiler::beginFrame()
+{
+	// this slot was used NUM_SLOTS frames ago
+	Slot &slot = slots_[frame_ % NUM_SLOTS];
+	if (slot.pending)
+		collect(slot);
+
+	slot.count = 0;
+	slot.last_query = 0;
+	in_frame_ = true;
+	depth_ = 0;
+}
+
+void Profiler::endFrame()
+{
+	Slot &slot = slots_[frame_ % NUM_SLOTS];
+	slot.pending = slot.count != 0;
+	in_frame_ = false;
+	++frame_;
+}
+
+unsigned Profiler::begin(const char *name)
+{
+	if (!in_frame_)
+	{
+		if (depth_ >= MAX_DEPTH)
+			return INVALID;
+
+		Marker &m = load_stack_[depth_];
+		m.name = name;
+		m.depth = depth_;
+		m.cpu_begin = now();
+		return LOAD_MARKER | depth_++;
+	}
+
+	Slot &slot = slots_[frame_ % NUM_SLOTS];
+	if (slot.count >= MAX_MARKERS)
+	{
+		++dropped_markers_;
+		return INVALID;
+	}
+
+	const unsigned idx = slot.count++;
+	Marker &m = slot.markers[idx];
+	m.name = name;
+	m.depth = depth_++;
+
+	if (debug_groups_)
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, idx, -1, name);
+
+	if (gpu_timers_)
+	{
+		glQueryCounter(slot.queries[idx * 2], GL_TIMESTAMP);
+		slot.last_query = slot.queries[idx * 2];
+	}
+
+	m.cpu_begin = now();
+	return idx;
+}
+
+void Profiler::end(unsigned marker)
+{
+	if (marker == INVALID)
+		return;
+
+	const double t = now();
+	--depth_;
+
+	if (marker & LOAD_MARKER)
+	{
+		const Marker &m = load_stack_[marker & ~LOAD_MARKER];
+		for (unsigned i = 0; i < m.depth; ++i)
+			std::cout << "   ";
+		std::cout << m.name << ": " << (t - m.cpu_begin) * 1000 << " ms" << std::endl;
+
+		addTraceEvent(m.name, 1, m.cpu_begin, t);
+		return;
+	}
+
+	Slot &slot = slots_[frame_ % NUM_SLOTS];
+	slot.markers[marker].cpu_end = t;
+
+	if (gpu_timers_)
+	{
+		glQueryCounter(slot.queries[marker * 2 + 1], GL_TIMESTAMP);
+		slot.last_query = slot.queries[marker * 2 + 1];
+	}
+
+	if (debug_groups_)
+		glPopDebugGroup();
+}
+
+void Profiler::collect(Slot &slot)
+{
+	slot.pending = false;
+
+	// queries finish in order, so the last one tells us about all of them
+	bool gpu_ready = false;
+	if (gpu_timers_ && slot.last_query)
+	{
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(slot.last_query, GL_QUERY_RESULT_AVAILABLE, &available);
+		gpu_ready = available == GL_TRUE;
+		if (!gpu_ready)
+			++dropped_frames_;
+	}
+
+	for (unsigned i = 0; i < num_stats_; ++i)
+	{
+		stats_[i].calls = 0;
+		stats_[i].cpu_ms = 0;
+		stats_[i].gpu_ms = 0;
+	}
+
+	for (unsigned i = 0; i < slot.count; ++i)
+	{
+		const Marker &m = slot.markers[i];
+		Stat &s = findStat(m.name, m.depth);
+		++s.calls;
+		s.cpu_ms += (m.cpu_end - m.cpu_begin) * 1000;
+		addTraceEvent(m.name, 1, m.cpu_begin, m.cpu_end);
+
+		if (gpu_ready)
+		{
+			GLuint64 begin_ns = 0, end_ns = 0;
+			glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &begin_ns);
+			glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &end_ns);
+			s.gpu_ms += (end_ns - begin_ns) / 1e6;
+
+			// line up with the CPU clock (at init)
+			addTraceEvent(m.name, 2,
+			    (GLint64(begin_ns) - gpu_base_) / 1e9,
+			    (GLint64(end_ns) - gpu_base_) / 1e9);
+		}
+	}
+
+	for (unsigned i = 0; i < num_stats_; ++i)
+	{
+		Stat &s = stats_[i];
+		s.avg_cpu_ms += (s.cpu_ms - s.avg_cpu_ms) * SMOOTHING;
+		if (gpu_ready)
+			s.avg_gpu_ms += (s.gpu_ms - s.avg_gpu_ms) * SMOOTHING;
+	}
+}
+
+Profiler::Stat& Profiler::findStat(const char *name, unsigned depth)
+{
+	// names are string literals, so compare pointers
+	for (unsigned i = 0; i < num_stats_; ++i)
+	{
+		if (stats_[i].name == name)
+			return stats_[i];
+	}
+
+	if (num_stats_ == MAX_STATS)
+	{
+		// lump the rest together
+		stats_[MAX_STATS - 1].name = "other";
+		return stats_[MAX_STATS - 1];
+	}
+
+	Stat &s = stats_[num_stats_++];
+	s = Stat();
+	s.name = name;
+	s.depth = depth;
+	return s;
+}
+
+void Profiler::startTrace(std::size_t max_events)
+{
+	trace_.clear();
+	trace_.reserve(max_events);
+	tracing_ = true;
+}
+
+void Profiler::addTraceEvent(const char *name, unsigned tid, double begin_s, double end_s)
+{
+	// full is full (no allocation while running)
+	if (!tracing_ || trace_.size() == trace_.capacity())
+		return;
+
+	TraceEvent e;
+	e.name = name;
+	e.tid = tid;
+	e.ts_us = begin_s * 1e6;
+	e.dur_us = (end_s - begin_s) * 1e6;
+	trace_.push_back(e);
+}
+
+bool Profiler::writeTrace(const char *path) const
+{
+	FILE *file = fopen(path, "w");
+	if (!file)
+	{
+		std::cerr << path << " could not be opened for writing." << std::endl;
+		return false;
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+	for (const auto &e : trace_)
+	{
+		// names are our own literals, no escaping needed
+		fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+		    e.name, e.tid, e.ts_us, e.dur_us);
+	}
+	fprintf(file, "\n]}\n");
+
+	// fclose flushes, so it can fail too
+	bool ok = ferror(file) == 0;
+	ok = fclose(file) == 0 && ok;
+
+	if (ok)
+		std::cout << "Wrote " << trace_.size() << " trace events to " << path << std::endl;
+	return ok;
+}
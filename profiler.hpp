@@ -0,0 +1,149 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+/// Frame profiler
+/// Markers time the CPU, and (when the driver has timer queries) the GPU with
+/// GL_TIMESTAMP queries. The queries are double buffered: the results for a
+/// frame are read two frames later, and dropped if they are not ready yet,
+/// so the pipeline is never stalled. Markers also push KHR_debug groups, so
+/// they show up in GPU debuggers.
+/// Markers outside of a frame (e.g. loading) are CPU only and printed as they end.
+class Profiler
+{
+public:
+	static constexpr unsigned MAX_MARKERS = 128; ///< per frame
+	static constexpr unsigned MAX_STATS = 64; ///< distinct marker names
+	static constexpr unsigned MAX_DEPTH = 16; ///< of nested load markers
+	static constexpr unsigned NUM_SLOTS = 2; ///< frames of queries in flight
+	static constexpr unsigned INVALID = ~0u; ///< marker which is ignored
+
+	/// running totals for one marker name
+	struct Stat
+	{
+		const char *name;
+		unsigned depth; ///< nesting (of the first use)
+		unsigned calls; ///< last frame
+		double cpu_ms; ///< last frame
+		double gpu_ms; ///< last frame
+		double avg_cpu_ms; ///< smoothed over frames
+		double avg_gpu_ms; ///< smoothed over frames
+	};
+
+	Profiler() = default;
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	/// call with a current GL context
+	void init();
+	/// release GL objects (before the context goes away)
+	void shutdown();
+
+	void beginFrame();
+	void endFrame();
+
+	/// start a marker, name must live forever (use a string literal)
+	unsigned begin(const char *name);
+	void end(unsigned marker);
+
+	/// record trace events (up to max_events), for writeTrace
+	void startTrace(std::size_t max_events);
+	/// Chrome trace event JSON (chrome://tracing or Perfetto)
+	bool writeTrace(const char *path) const;
+
+	unsigned numStats() const { return num_stats_; }
+	const Stat& stat(unsigned i) const { return stats_[i]; }
+
+	/// frames whose GPU results weren't ready in time
+	unsigned droppedFrames() const { return dropped_frames_; }
+	/// markers ignored because a frame already had MAX_MARKERS
+	unsigned droppedMarkers() const { return dropped_markers_; }
+	bool hasGpuTimers() const { return gpu_timers_; }
+
+private: // types
+	struct Marker
+	{
+		const char *name;
+		unsigned depth;
+		double cpu_begin; ///< seconds
+		double cpu_end; ///< seconds
+	};
+
+	/// markers (and their queries) of one frame
+	struct Slot
+	{
+		Marker markers[MAX_MARKERS];
+		GLuint queries[MAX_MARKERS * 2]; ///< begin and end timestamp of each marker
+		unsigned count = 0;
+		GLuint last_query = 0; ///< the last one issued (done means all are done)
+		bool pending = false; ///< has results to read
+	};
+
+	struct TraceEvent
+	{
+		const char *name;
+		unsigned tid; ///< 1 for CPU, 2 for GPU
+		double ts_us;
+		double dur_us;
+	};
+
+private: // methods
+	/// seconds since init
+	double now() const;
+
+	void collect(Slot &slot);
+	Stat& findStat(const char *name, unsigned depth);
+	void addTraceEvent(const char *name, unsigned tid, double begin_s, double end_s);
+
+private: // data
+	bool gpu_timers_ = false; ///< GL_TIMESTAMP queries are supported
+	bool debug_groups_ = false; ///< KHR_debug is supported
+
+	Slot slots_[NUM_SLOTS];
+	unsigned frame_ = 0;
+	bool in_frame_ = false;
+	unsigned depth_ = 0; ///< current nesting
+
+	Marker load_stack_[MAX_DEPTH]; ///< open markers outside of a frame
+
+	Stat stats_[MAX_STATS];
+	unsigned num_stats_ = 0;
+	unsigned dropped_frames_ = 0;
+	unsigned dropped_markers_ = 0;
+
+	double cpu_base_ = 0; ///< steady clock at init (seconds)
+	GLint64 gpu_base_ = 0; ///< GPU timestamp at init (nanoseconds)
+
+	bool tracing_ = false;
+	std::vector<TraceEvent> trace_; ///< reserved by startTrace
+};
+
+/// the profiler for this program
+Profiler& profiler();
+
+/// time the rest of the enclosing block
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char *name)
+	: marker_(profiler().begin(name))
+	{
+	}
+
+	~ProfileScope()
+	{
+		profiler().end(marker_);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	unsigned marker_;
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
@@ -0,0 +1,181 @@
+#include "regression.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+/// nearest rank (v is sorted and not empty)
+float percentile(const std::vector<float> &v, float pct)
+{
+	const std::size_t rank = std::size_t(pct / 100.f * v.size() + 0.5f);
+	return v[std::min(rank == 0 ? 0 : rank - 1, v.size() - 1)];
+}
+
+}
+
+FrameStats frameStats(std::vector<float> &frame_ms)
+{
+	FrameStats st;
+	if (frame_ms.empty())
+		return st;
+
+	std::sort(frame_ms.begin(), frame_ms.end());
+
+	double total = 0;
+	for (const float ms : frame_ms)
+		total += ms;
+
+	st.frames = frame_ms.size();
+	st.avg_ms = total / frame_ms.size();
+	st.p50_ms = percentile(frame_ms, 50.f);
+	st.p90_ms = percentile(frame_ms, 90.f);
+	st.p99_ms = percentile(frame_ms, 99.f);
+	st.max_ms = frame_ms.back();
+	return st;
+}
+
+bool readRegressionSuite(const char *suite_path, RegressionSuite &suite)
+{
+	std::ifstream in(suite_path, std::ios::in);
+	if (!in.is_open())
+	{
+		std::cerr << "Failed to open regression suite " << suite_path << std::endl;
+		return false;
+	}
+
+	// directory of the suite (including the slash)
+	std::string dir(suite_path);
+	const std::string::size_type slash = dir.find_last_of("/\\");
+	dir = slash == std::string::npos ? std::string() : dir.substr(0, slash + 1);
+
+	std::string line;
+	unsigned line_num = 0;
+	while (std::getline(in, line))
+	{
+		++line_num;
+
+		std::istringstream str(line);
+		std::string kind;
+		if (!(str >> kind) || kind[0] == '#')
+			continue;
+
+		std::string name;
+		if (!(str >> name))
+		{
+			std::cerr << suite_path << ':' << line_num << ": expected a path" << std::endl;
+			return false;
+		}
+		const std::string path = name[0] == '/' ? name : dir + name;
+
+		if (kind == "model")
+		{
+			RegressionSuite::Models m;
+			m.name = name;
+
+			ManifestEntry entry;
+			entry.path = path;
+			entry.placement = glm::mat4(1.0f);
+			m.entries.push_back(entry);
+
+			suite.models.push_back(m);
+		}
+		else if (kind == "manifest")
+		{
+			RegressionSuite::Models m;
+			m.name = name;
+			if (!readManifest(path.c_str(), m.entries))
+				return false;
+
+			suite.models.push_back(m);
+		}
+		else if (kind == "path")
+		{
+			RegressionSuite::Recording r;
+			r.name = name;
+			r.path = path;
+			suite.recordings.push_back(r);
+		}
+		else
+		{
+			std::cerr << suite_path << ':' << line_num << ": unknown item " << kind << std::endl;
+			return false;
+		}
+	}
+
+	if (suite.models.empty() || suite.recordings.empty())
+	{
+		std::cerr << suite_path << " needs models and camera paths" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool readBaseline(const char *path, Baseline &baseline)
+{
+	std::ifstream in(path, std::ios::in);
+	if (!in.is_open())
+	{
+		std::cerr << "Failed to open baseline " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	unsigned line_num = 0;
+	while (std::getline(in, line))
+	{
+		++line_num;
+
+		std::istringstream str(line);
+		std::string name;
+		if (!(str >> name) || name[0] == '#')
+			continue;
+
+		FrameStats st;
+		if (!(str >> st.frames >> st.avg_ms >> st.p50_ms >> st.p90_ms >> st.p99_ms >> st.max_ms))
+		{
+			std::cerr << path << ':' << line_num << ": expected frames avg p50 p90 p99 max" << std::endl;
+			return false;
+		}
+		baseline[name] = st;
+	}
+
+	return true;
+}
+
+bool writeBaseline(const char *path, const Baseline &baseline)
+{
+	std::ofstream out(path, std::ios::out);
+	if (!out.is_open())
+	{
+		std::cerr << path << " could not be opened for writing." << std::endl;
+		return false;
+	}
+
+	out << "# case frames avg_ms p50_ms p90_ms p99_ms max_ms" << std::endl;
+	for (const auto &i : baseline)
+	{
+		const FrameStats &st = i.second;
+		out << i.first << ' ' << st.frames << ' ' << st.avg_ms << ' '
+		    << st.p50_ms << ' ' << st.p90_ms << ' ' << st.p99_ms << ' '
+		    << st.max_ms << std::endl;
+	}
+
+	if (!out)
+	{
+		std::cerr << "Failed writing " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool withinTolerance(const FrameStats &baseline, const FrameStats &current,
+    float tolerance_pct, float slack_ms)
+{
+	const float scale = 1.f + tolerance_pct / 100.f;
+	return current.p50_ms <= baseline.p50_ms * scale + slack_ms
+	    && current.p90_ms <= baseline.p90_ms * scale + slack_ms
+	    && current.p99_ms <= baseline.p99_ms * scale + slack_ms;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "manifest.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+/// Frame time distribution of one run
+struct FrameStats
+{
+	unsigned frames = 0;
+	float avg_ms = 0;
+	float p50_ms = 0;
+	float p90_ms = 0;
+	float p99_ms = 0;
+	float max_ms = 0;
+};
+
+/// from the time of every frame (sorted in place)
+FrameStats frameStats(std::vector<float> &frame_ms);
+
+/// Camera recordings to replay over sets of models
+struct RegressionSuite
+{
+	struct Models
+	{
+		std::string name; ///< as written in the suite
+		std::vector<ManifestEntry> entries;
+	};
+
+	struct Recording
+	{
+		std::string name; ///< as written in the suite
+		std::string path;
+	};
+
+	std::vector<Models> models;
+	std::vector<Recording> recordings;
+};
+
+/// Read a regression suite, a text file with one item per line:
+///    model path      (one model on its own)
+///    manifest path   (a scene manifest)
+///    path file       (a camera recording)
+/// Every recording is replayed over every model (or manifest).
+/// Blank lines and lines starting with '#' are skipped.
+/// Relative paths are relative to the suite, names can't have spaces.
+bool readRegressionSuite(const char *suite_path, RegressionSuite &suite);
+
+/// stats of each case ("models@recording")
+typedef std::map<std::string, FrameStats> Baseline;
+
+bool readBaseline(const char *path, Baseline &baseline);
+bool writeBaseline(const char *path, const Baseline &baseline);
+
+/// the percentiles are no more than tolerance_pct percent (plus slack_ms, for
+/// timer noise on fast frames) over the baseline
+bool withinTolerance(const FrameStats &baseline, const FrameStats &current,
+    float tolerance_pct, float slack_ms);
@@ -0,0 +1,301 @@
+#include "residency.hpp"
+#include "hash.hpp"
+#include "loadBmp.h"
+#include "loadShaders.hpp"
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+
+/// content hash of a whole file (0 if it can't be read)
+std::uint64_t hashFile(const char *path, std::uint64_t seed = 14695981039346656037ull)
+{
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in.is_open())
+		return 0;
+
+	std::stringstream str;
+	str << in.rdbuf();
+	const std::string contents = str.str();
+	return hashBytes(contents.data(), contents.size(), seed);
+}
+
+}
+
+//----------------------------------------------------------------------------
+Texture::Texture(std::uint64_t hash, const std::string &path)
+: hash_(hash)
+, path_(path)
+{
+}
+
+Texture::~Texture()
+{
+	evict();
+}
+
+bool Texture::load()
+{
+	evict();
+
+	id_ = loadBmp(path_.c_str());
+	if (!id_)
+		return false;
+
+	// drivers pad RGB to 4 bytes, mipmaps add a third
+	GLint width = 0, height = 0;
+	glBindTexture(GL_TEXTURE_2D, id_);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+	gpu_bytes_ = std::size_t(width) * height * 4 * 4 / 3;
+
+	return true;
+}
+
+void Texture::evict()
+{
+	if (!resident())
+		return;
+
+	glDeleteTextures(1, &id_);
+	id_ = 0;
+	gpu_bytes_ = 0;
+}
+
+//----------------------------------------------------------------------------
+ResidencyManager::ResidencyManager(std::size_t budget_bytes, const std::string &cache_dir)
+: budget_(budget_bytes)
+, cache_dir_(cache_dir)
+{
+}
+
+ResidencyManager::~ResidencyManager()
+{
+	for (auto &i : meshes_)
+		delete i.second;
+	for (auto &i : textures_)
+		delete i.second;
+	for (auto &i : programs_)
+	{
+		glDeleteProgram(i.second->id);
+		delete i.second;
+	}
+}
+
+Mesh* ResidencyManager::acquireMesh(const MeshData &data)
+{
+	const std::uint64_t hash = data.hash();
+
+	auto i = meshes_.find(hash);
+	if (i != meshes_.end())
+	{
+		++i->second->refs_;
+		return i->second;
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.yymesh", (unsigned long long)hash);
+	Mesh *mesh = new Mesh(hash, cache_dir_ + '/' + name);
+
+	// the cache file name is the content hash, so a complete existing file is good
+	mesh->cached_ = checkMeshCache(mesh->cachePath(), data) || writeMeshCache(mesh->cachePath(), data);
+	if (!mesh->cached_)
+		std::cerr << "Mesh " << name << " can't be evicted" << std::endl;
+
+	mesh->upload(data);
+	mesh->refs_ = 1;
+	mesh->last_visible_ = frame_;
+	gpu_bytes_ += mesh->gpuBytes();
+
+	meshes_[hash] = mesh;
+	victims_.reserve(meshes_.size() + textures_.size());
+	return mesh;
+}
+
+Texture* ResidencyManager::acquireTexture(const char *image_path)
+{
+	const std::uint64_t hash = hashFile(image_path);
+	if (hash == 0)
+	{
+		std::cerr << image_path << " could not be opened." << std::endl;
+		return nullptr;
+	}
+
+	auto i = textures_.find(hash);
+	if (i != textures_.end())
+	{
+		++i->second->refs_;
+		return i->second;
+	}
+
+	Texture *texture = new Texture(hash, image_path);
+	if (!texture->load())
+	{
+		delete texture;
+		return nullptr;
+	}
+
+	texture->refs_ = 1;
+	texture->last_visible_ = frame_;
+	gpu_bytes_ += texture->gpuBytes();
+
+	textures_[hash] = texture;
+	victims_.reserve(meshes_.size() + textures_.size());
+	return texture;
+}
+
+Program* ResidencyManager::acquireProgram(const char *vertex_path, const char *fragment_path)
+{
+	const std::uint64_t hash = hashFile(fragment_path, hashFile(vertex_path));
+
+	auto i = programs_.find(hash);
+	if (i != programs_.end())
+	{
+		++i->second->refs;
+		return i->second;
+	}
+
+	const GLuint id = loadShaders(vertex_path, fragment_path);
+	if (!id)
+		return nullptr;
+
+	Program *program = new Program;
+	program->hash = hash;
+	program->id = id;
+	program->refs = 1;
+
+	programs_[hash] = program;
+	return program;
+}
+
+void ResidencyManager::release(Mesh *mesh)
+{
+	if (!mesh || --mesh->refs_ != 0)
+		return;
+
+	gpu_bytes_ -= mesh->gpuBytes();
+	meshes_.erase(mesh->hash());
+	delete mesh;
+}
+
+void ResidencyManager::release(Texture *texture)
+{
+	if (!texture || --texture->refs_ != 0)
+		return;
+
+	gpu_bytes_ -= texture->gpuBytes();
+	textures_.erase(texture->hash());
+	delete texture;
+}
+
+void ResidencyManager::release(Program *program)
+{
+	if (!program || --program->refs != 0)
+		return;
+
+	programs_.erase(program->hash);
+	glDeleteProgram(program->id);
+	delete program;
+}
+
+bool ResidencyManager::touch(Mesh *mesh)
+{
+	mesh->last_visible_ = frame_;
+	if (mesh->resident())
+		return true;
+
+	// the cache failed before
+	if (!mesh->cached_)
+		return false;
+
+	if (!readMeshCache(mesh->cachePath(), reload_data_))
+	{
+		// don't try again
+		mesh->cached_ = false;
+		return false;
+	}
+
+	mesh->upload(reload_data_);
+	gpu_bytes_ += mesh->gpuBytes();
+	++reloads_;
+	return true;
+}
+
+bool ResidencyManager::touch(Texture *texture)
+{
+	texture->last_visible_ = frame_;
+	if (texture->resident())
+		return true;
+
+	if (!texture->load())
+		return false;
+
+	gpu_bytes_ += texture->gpuBytes();
+	++reloads_;
+	return true;
+}
+
+bool ResidencyManager::evict(Mesh *mesh)
+{
+	if (!mesh->cached_)
+		return false;
+
+	if (mesh->resident())
+	{
+		gpu_bytes_ -= mesh->gpuBytes();
+		mesh->evict();
+		++evictions_;
+	}
+	return true;
+}
+
+void ResidencyManager::endFrame()
+{
+	PROFILE_SCOPE("residency");
+
+	if (budget_ != 0 && gpu_bytes_ > budget_)
+	{
+		victims_.clear();
+		for (auto &i : meshes_)
+		{
+			Mesh *mesh = i.second;
+			if (mesh->resident() && mesh->cached_ && mesh->last_visible_ != frame_)
+				victims_.push_back(Victim{mesh->last_visible_, mesh, nullptr});
+		}
+		for (auto &i : textures_)
+		{
+			Texture *texture = i.second;
+			if (texture->resident() && texture->last_visible_ != frame_)
+				victims_.push_back(Victim{texture->last_visible_, nullptr, texture});
+		}
+
+		// oldest first
+		std::sort(victims_.begin(), victims_.end(),
+		    [](const Victim &a, const Victim &b) { return a.last_visible < b.last_visible; });
+
+		for (const auto &v : victims_)
+		{
+			if (gpu_bytes_ <= budget_)
+				break;
+
+			if (v.mesh)
+			{
+				gpu_bytes_ -= v.mesh->gpuBytes();
+				v.mesh->evict();
+			}
+			else
+			{
+				gpu_bytes_ -= v.texture->gpuBytes();
+				v.texture->evict();
+			}
+			++evictions_;
+		}
+	}
+
+	++frame_;
+}
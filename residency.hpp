@@ -0,0 +1,127 @@
+#pragma once
+
+#include "mesh.hpp"
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//----------------------------------------------------------------------------
+/// Compiled shader program, shared by all scenes with the same source
+struct Program
+{
+	std::uint64_t hash = 0; ///< of the shader source text
+	GLuint id = 0;
+	unsigned refs = 0;
+};
+
+//----------------------------------------------------------------------------
+/// Texture, shared by all scenes with the same image file contents
+/// May be evicted, and reloaded from its file
+class Texture
+{
+public:
+	Texture(std::uint64_t hash, const std::string &path);
+
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
+	~Texture();
+
+	bool load();
+	void evict();
+
+	bool resident() const { return id_ != 0; }
+	GLuint id() const { return id_; }
+	std::uint64_t hash() const { return hash_; }
+	std::size_t gpuBytes() const { return gpu_bytes_; }
+
+private:
+	friend class ResidencyManager;
+	unsigned refs_ = 0; ///< scenes using this texture
+	unsigned last_visible_ = 0; ///< frame number
+
+	std::uint64_t hash_ = 0; ///< of the file contents
+	std::string path_; ///< where to reload from
+	GLuint id_ = 0; ///< texture id (image data in OpenGL)
+	std::size_t gpu_bytes_ = 0; ///< estimate, including mipmaps
+};
+
+//----------------------------------------------------------------------------
+/// Owner of all GPU resources (shared between scenes by content hash)
+/// Keeps GPU memory use under a budget by evicting meshes and textures which
+/// have not been visible for the longest time. Evicted meshes are reloaded
+/// from the binary cache when they become visible again.
+class ResidencyManager
+{
+public:
+	/// budget of 0 is unlimited
+	ResidencyManager(std::size_t budget_bytes, const std::string &cache_dir);
+
+	ResidencyManager(const ResidencyManager&) = delete;
+	ResidencyManager& operator=(const ResidencyManager&) = delete;
+
+	~ResidencyManager();
+
+	// get shared resources (reference counted)
+	// return nullptr on failure
+
+	Mesh* acquireMesh(const MeshData &data);
+	Texture* acquireTexture(const char *image_path);
+	Program* acquireProgram(const char *vertex_path, const char *fragment_path);
+
+	void release(Mesh *mesh);
+	void release(Texture *texture);
+	void release(Program *program);
+
+	/// mark as visible this frame (reloading if evicted)
+	/// returns false if it is not resident (and can't be drawn)
+	bool touch(Mesh *mesh);
+	bool touch(Texture *texture);
+
+	/// evict a mesh now (it is reloaded when touched)
+	/// returns false if it can't be evicted
+	bool evict(Mesh *mesh);
+
+	/// GPU memory owned elsewhere, which counts against the budget
+	/// (it is never evicted, so it leaves less for meshes and textures)
+	void reserve(std::size_t bytes) { gpu_bytes_ += bytes; }
+	void unreserve(std::size_t bytes) { gpu_bytes_ -= bytes; }
+
+	/// evict the least recently visible resources, until under budget
+	/// (resources visible this frame are never evicted)
+	void endFrame();
+
+	unsigned frame() const { return frame_; }
+	std::size_t gpuBytes() const { return gpu_bytes_; }
+	std::size_t budget() const { return budget_; }
+	unsigned evictions() const { return evictions_; }
+	unsigned reloads() const { return reloads_; }
+
+private: // types
+	/// eviction candidate
+	struct Victim
+	{
+		unsigned last_visible;
+		Mesh *mesh;
+		Texture *texture;
+	};
+
+private: // data
+	std::size_t budget_; ///< bytes of GPU memory
+	std::string cache_dir_; ///< binary cache files go here
+
+	std::unordered_map<std::uint64_t, Mesh*> meshes_;
+	std::unordered_map<std::uint64_t, Texture*> textures_;
+	std::unordered_map<std::uint64_t, Program*> programs_;
+
+	std::vector<Victim> victims_; ///< scratch for endFrame (sized on acquire)
+	MeshData reload_data_; ///< scratch for reading the binary cache
+
+	unsigned frame_ = 1; ///< current frame number
+	std::size_t gpu_bytes_ = 0; ///< resident meshes and textures, and reserved
+	unsigned evictions_ = 0;
+	unsigned reloads_ = 0;
+};
@@ -0,0 +1,347 @@
+#include "scene.hpp"
+#include "controls.hpp"
+#include "meshlet.hpp"
+#include "profiler.hpp"
+#include "residency.hpp"
+#include "shadows.hpp"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <iostream>
+
+namespace
+{
+
+bool hasMeshes(const aiNode *node)
+{
+	if (node->mNumMeshes > 0)
+		return true;
+
+	for (unsigned i = 0; i < node->mNumChildren; ++i)
+	{
+		if (hasMeshes(node->mChildren[i]))
+			return true;
+	}
+
+	return false;
+}
+
+/// assimp is row major, glm is column major
+glm::mat4 toGlm(const aiMatrix4x4 &m)
+{
+	return glm::mat4(
+	    m.a1, m.b1, m.c1, m.d1,
+	    m.a2, m.b2, m.c2, m.d2,
+	    m.a3, m.b3, m.c3, m.d3,
+	    m.a4, m.b4, m.c4, m.d4);
+}
+
+}
+
+//----------------------------------------------------------------------------
+unsigned Node::resolveMeshes(const aiNode *node, Mesh *const *meshes, Arena &arena)
+{
+	name_ = arena.copyString(node->mName.C_Str());
+	std::cout << "Creating node " << name_ << std::endl;
+
+	transform_ = toGlm(node->mTransformation);
+
+	// only keep children which have something to draw
+	for (unsigned i = 0; i < node->mNumChildren; ++i)
+	{
+		if (hasMeshes(node->mChildren[i]))
+			++num_children_;
+	}
+
+	unsigned num_instances = node->mNumMeshes;
+
+	children_ = arena.allocArray<Node*>(num_children_);
+	unsigned child_idx = 0;
+	for (unsigned i = 0; i < node->mNumChildren; ++i)
+	{
+		const aiNode *child = node->mChildren[i];
+		if (hasMeshes(child))
+		{
+			Node *child_node = arena.create<Node>();
+			num_instances += child_node->resolveMeshes(child, meshes, arena);
+			children_[child_idx++] = child_node;
+		}
+	}
+
+	// pull mesh pointers from global mesh array via index
+	num_meshes_ = node->mNumMeshes;
+	meshes_ = arena.allocArray<Mesh*>(num_meshes_);
+	for (unsigned i = 0; i < num_meshes_; ++i)
+	{
+		const unsigned mesh_idx = node->mMeshes[i];
+		meshes_[i] = meshes[mesh_idx];
+	}
+
+	return num_instances;
+}
+
+void Node::collect(const glm::mat4 &parent, const Frustum &frustum, DrawList &list) const
+{
+	const glm::mat4 world = parent * transform_;
+
+	for (unsigned i = 0; i < num_meshes_ && list.count < list.capacity; ++i)
+	{
+		Mesh *mesh = meshes_[i];
+		if (!isBoxVisible(frustum, world, mesh->boundsMin(), mesh->boundsMax()))
+			continue;
+
+		DrawPacket &p = list.packets[list.count++];
+		p.mesh = mesh;
+		p.model = world;
+	}
+
+	for (unsigned i = 0; i < num_children_; ++i)
+		children_[i]->collect(world, frustum, list);
+}
+
+//----------------------------------------------------------------------------
+Scene::~Scene()
+{
+	unload();
+}
+
+void Scene::unload()
+{
+	if (resources_)
+	{
+		for (unsigned i = 0; i < num_meshes_; ++i)
+			resources_->release(meshes_[i]);
+		resources_->release(texture_);
+		resources_->release(program_);
+	}
+
+	arena_.reset();
+	root_ = nullptr;
+	meshes_ = nullptr;
+	num_meshes_ = 0;
+	num_instances_ = 0;
+
+	texture_ = nullptr;
+	program_ = nullptr;
+	resources_ = nullptr;
+}
+
+bool Scene::load(const char *obj_path, ResidencyManager &resources, const glm::mat4 &placement)
+{
+	PROFILE_SCOPE("load");
+	unload();
+
+	Assimp::Importer importer;
+	// TODO: other flags? configuration?
+	const unsigned flags = aiProcess_CalcTangentSpace
+	    | aiProcess_Triangulate
+	    | aiProcess_JoinIdenticalVertices
+	    | aiProcess_SortByPType;
+	const aiScene *scene = nullptr;
+	{
+		PROFILE_SCOPE("import");
+		scene = importer.ReadFile(obj_path, flags);
+	}
+	if (!scene)
+	{
+		std::cerr << "Failed to import " << obj_path << std::endl;
+		return false;
+	}
+
+	resources_ = &resources;
+	placement_ = placement;
+
+	// read and compile shaders
+	{
+		PROFILE_SCOPE("shaders");
+		program_ = resources.acquireProgram("../standardShading.vert.glsl", "../standardShading.frag.glsl");
+	}
+	if (!program_)
+		return false;
+	const GLuint program_id = program_->id;
+
+	// get a handle for our "MVP" uniform
+	matrix_id_ = glGetUniformLocation(program_id, "MVP");
+	view_matrix_id_ = glGetUniformLocation(program_id, "V");
+	model_matrix_id_ = glGetUniformLocation(program_id, "M");
+
+	// load the texture
+	{
+		PROFILE_SCOPE("texture");
+		texture_ = resources.acquireTexture("../uvtemplate.bmp");
+	}
+	if (!texture_)
+		return false;
+
+	// get a handle for our texture sampler uniform
+	texture_id_  = glGetUniformLocation(program_id, "myTextureSampler");
+
+	light_id_ = glGetUniformLocation(program_id, "LightDirection_worldspace");
+	shadow_uniforms_.find(program_id);
+
+	// TODO: materials
+	// TODO: animations
+
+	const unsigned meshes_marker = profiler().begin("meshes");
+
+	// scratch buffers, shared by all meshes (they only grow)
+	MeshData data;
+
+	// meshes
+	num_meshes_ = scene->mNumMeshes;
+	meshes_ = arena_.allocArray<Mesh*>(num_meshes_);
+	for (unsigned i = 0; i < scene->mNumMeshes; ++i)
+	{
+		const aiMesh *paiMesh = scene->mMeshes[i];
+		if (paiMesh->mNumAnimMeshes != 0)
+		{
+			std::cerr << "Mesh " << i << " with animations!" << std::endl;
+		}
+		// TODO: handle other texture maps...
+		const bool has_texture_coords = paiMesh->HasTextureCoords(0);
+		const bool has_normals = paiMesh->HasNormals();
+
+		const glm::vec3 zero(0.f, 0.f, 0.f);
+		data.clear();
+		data.vertices.reserve(paiMesh->mNumVertices);
+		data.uvs.reserve(paiMesh->mNumVertices);
+		data.normals.reserve(paiMesh->mNumVertices);
+
+		for (unsigned j = 0; j < paiMesh->mNumVertices; ++j)
+		{
+			const aiVector3D *pPos = &paiMesh->mVertices[j];
+			data.vertices.push_back(glm::vec3(pPos->x, pPos->y, pPos->z));
+
+			if (has_texture_coords)
+			{
+				const aiVector3D *pTexCoord = &paiMesh->mTextureCoords[0][j];
+				data.uvs.push_back(glm::vec2(pTexCoord->x, pTexCoord->y));
+			}
+			else
+			{
+				data.uvs.push_back(glm::vec2(zero.x, zero.y));
+			}
+
+			if (has_normals)
+			{
+				const aiVector3D *pNormal = &paiMesh->mNormals[j];
+				data.normals.push_back(glm::vec3(pNormal->x, pNormal->y, pNormal->z));
+			}
+			else
+			{
+				data.normals.push_back(glm::vec3(zero.x, zero.y, zero.z));
+			}
+		}
+
+		// faces are triangulated on import
+		data.faces.reserve(paiMesh->mNumFaces * 3);
+		for (unsigned i = 0; i < paiMesh->mNumFaces; ++i)
+		{
+			const aiFace &face = paiMesh->mFaces[i];
+			for (unsigned j = 0; j < face.mNumIndices; ++j)
+			{
+				data.faces.push_back(face.mIndices[j]);
+			}
+		}
+
+		// clusters, so big meshes aren't all or nothing
+		// (points and lines are kept by SortByPType, they are drawn whole)
+		if (paiMesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+			buildMeshlets(data);
+		else
+			buildSingleMeshlet(data);
+
+		// identical meshes (from any model) share one copy
+		meshes_[i] = resources.acquireMesh(data);
+	}
+
+	profiler().end(meshes_marker);
+
+	PROFILE_SCOPE("nodes");
+	root_ = arena_.create<Node>();
+	num_instances_ = root_->resolveMeshes(scene->mRootNode, meshes_, arena_);
+
+	return true;
+}
+
+void Scene::cull(const Frustum &frustum)
+{
+	// the last pass's packets are done
+	frame_arena_.reset();
+	list_ = DrawList();
+
+	if (!root_)
+		return;
+
+	list_.capacity = num_instances_;
+	list_.packets = frame_arena_.allocArray<DrawPacket>(list_.capacity);
+	root_->collect(placement_, frustum, list_);
+}
+
+void Scene::render(const Controls &controls, const Frustum &frustum,
+    const glm::vec3 &light_dir, const CascadedShadows *shadows)
+{
+	if (list_.count == 0 || !resources_->touch(texture_))
+		return;
+
+	glUseProgram(program_->id);
+
+	glm::mat4 projection_matrix = controls.projectionMatrix();
+	glm::mat4 view_matrix = controls.viewMatrix();
+	glm::mat4 vp = projection_matrix * view_matrix;
+	const glm::vec4 camera = glm::inverse(view_matrix)[3];
+
+	glUniform3f(light_id_, light_dir.x, light_dir.y, light_dir.z);
+
+	glUniformMatrix4fv(view_matrix_id_, 1, GL_FALSE, &view_matrix[0][0]);
+	CascadedShadows::apply(shadows, shadow_uniforms_);
+
+	// textures are shared, so bind ours
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture_->id());
+	glUniform1i(texture_id_, 0);
+
+	for (unsigned i = 0; i < list_.count; ++i)
+	{
+		const DrawPacket &p = list_.packets[i];
+		if (!resources_->touch(p.mesh))
+			continue;
+
+		glm::mat4 mvp = vp * p.model;
+
+		// set model view projection matrix
+		glUniformMatrix4fv(matrix_id_, 1, GL_FALSE, &mvp[0][0]);
+		glUniformMatrix4fv(model_matrix_id_, 1, GL_FALSE, &p.model[0][0]);
+
+		p.mesh->render(p.model, frustum, camera, frame_arena_);
+	}
+}
+
+void Scene::renderDepth(const glm::mat4 &light_vp, const Frustum &light_frustum,
+    const glm::vec3 &light_dir, GLint mvp_id)
+{
+	// the last pass's packets are done
+	frame_arena_.reset();
+	list_ = DrawList();
+
+	if (!root_)
+		return;
+
+	DrawList list;
+	list.capacity = num_instances_;
+	list.packets = frame_arena_.allocArray<DrawPacket>(list.capacity);
+	root_->collect(placement_, light_frustum, list);
+
+	for (unsigned i = 0; i < list.count; ++i)
+	{
+		const DrawPacket &p = list.packets[i];
+		// casting a shadow counts as visible
+		if (!resources_->touch(p.mesh))
+			continue;
+
+		glm::mat4 mvp = light_vp * p.model;
+		glUniformMatrix4fv(mvp_id, 1, GL_FALSE, &mvp[0][0]);
+
+		p.mesh->renderDepth(p.model, light_frustum, glm::vec4(light_dir, 0.f), frame_arena_);
+	}
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "arena.hpp"
+#include "frustum.hpp"
+#include "mesh.hpp"
+#include "shadowUniforms.hpp"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+class CascadedShadows;
+class Controls;
+class ResidencyManager;
+class Texture;
+struct Program;
+struct aiNode;
+
+//----------------------------------------------------------------------------
+/// One draw for this frame
+struct DrawPacket
+{
+	Mesh *mesh;
+	glm::mat4 model; ///< model to world
+};
+
+/// Draws collected for this frame (lives in the frame arena)
+struct DrawList
+{
+	DrawPacket *packets = nullptr;
+	unsigned count = 0;
+	unsigned capacity = 0;
+};
+
+//----------------------------------------------------------------------------
+/// Tree of transforms, with meshes hanging off of it
+/// Everything is allocated in the owning scene's arena
+class Node
+{
+public:
+	Node() = default;
+
+	/// build this node (and its children) from the importer's node
+	/// returns the number of meshes referenced by the subtree
+	unsigned resolveMeshes(const aiNode *node, Mesh *const *meshes, Arena &arena);
+
+	/// append a packet for every mesh in the subtree inside the frustum
+	void collect(const glm::mat4 &parent, const Frustum &frustum, DrawList &list) const;
+
+	const glm::mat4& transform() const { return transform_; }
+	unsigned numChildren() const { return num_children_; }
+	const Node* child(unsigned i) const { return children_[i]; }
+	unsigned numMeshes() const { return num_meshes_; }
+	Mesh* mesh(unsigned i) const { return meshes_[i]; }
+
+protected:
+	const char *name_ = ""; ///< name (used in animation)
+	glm::mat4 transform_ = glm::mat4(1.0f); ///< relative to parent
+	Node **children_ = nullptr; ///< tree of children
+	unsigned num_children_ = 0;
+	Mesh **meshes_ = nullptr; ///< meshes on this node
+	unsigned num_meshes_ = 0;
+};
+
+//----------------------------------------------------------------------------
+/// One loaded model, placed in the world
+/// GL resources come from (and are shared through) the ResidencyManager
+class Scene
+{
+public:
+	Scene() = default;
+
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	~Scene();
+
+	/// placement is the model to world transform
+	bool load(const char *obj_path, ResidencyManager &resources,
+	    const glm::mat4 &placement = glm::mat4(1.0f));
+
+	/// release everything from load
+	void unload();
+
+	/// find the meshes inside the frustum
+	void cull(const Frustum &frustum);
+
+	/// draw what the last cull found (with the same frustum, for the meshlets)
+	/// the controls have computed this frame's matrices
+	/// light_dir is the direction the light shines (normalized)
+	void render(const Controls &controls, const Frustum &frustum,
+	    const glm::vec3 &light_dir, const CascadedShadows *shadows = nullptr);
+
+	/// draw the meshes inside a shadow cascade (its depth program is bound)
+	void renderDepth(const glm::mat4 &light_vp, const Frustum &light_frustum,
+	    const glm::vec3 &light_dir, GLint mvp_id);
+
+	const Node* root() const { return root_; }
+	const glm::mat4& placement() const { return placement_; }
+
+private:
+	Arena arena_; ///< nodes, mesh pointers and names (freed by unload)
+	Arena frame_arena_{16 * 1024}; ///< scratch for one pass (reset by cull and renderDepth)
+	DrawList list_; ///< from cull (lives in the frame arena)
+
+	ResidencyManager *resources_ = nullptr; ///< where our meshes came from
+	glm::mat4 placement_ = glm::mat4(1.0f); ///< model to world
+
+	Node *root_ = nullptr; ///< root of the model
+	Mesh **meshes_ = nullptr; ///< meshes used by the model (shared)
+	unsigned num_meshes_ = 0;
+	unsigned num_instances_ = 0; ///< mesh references in the node tree
+
+	Program *program_ = nullptr; ///< compiled vertex and shader program (shared)
+
+	// handles of "MVP" uniform
+	GLuint matrix_id_ = 0;
+	GLuint view_matrix_id_ = 0;
+	GLuint model_matrix_id_ = 0;
+
+	Texture *texture_ = nullptr; ///< image data in OpenGL (shared)
+	GLuint texture_id_ = 0; ///< handle for our texture sampler uniform (for shader)
+
+	GLuint light_id_ = 0; ///< shader uniform
+	ShadowUniforms shadow_uniforms_;
+};
@@ -0,0 +1,12 @@
+#version 330 core
+
+// shadow map depth, positions only
+layout(location = 0) in vec3 vertexPosition_modelspace;
+
+// model to light clip space
+uniform mat4 MVP;
+
+void main()
+{
+	gl_Position = MVP * vec4(vertexPosition_modelspace, 1);
+}
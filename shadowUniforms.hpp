@@ -0,0 +1,15 @@
+#pragma once
+
+#include <GL/glew.h>
+
+//----------------------------------------------------------------------------
+/// Where a shading program wants the shadow data (for CascadedShadows::apply)
+struct ShadowUniforms
+{
+	GLint matrices = -1;
+	GLint splits = -1;
+	GLint enabled = -1;
+	GLint map = -1;
+
+	void find(GLuint program_id);
+};
@@ -0,0 +1,240 @@
+#include "shadows.hpp"
+#include "controls.hpp"
+#include "residency.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+
+/// shadows end here (or at the far plane)
+const float SHADOW_DISTANCE = 50.f;
+
+/// blend of logarithmic (1) and even (0) cascade splits
+const float SPLIT_LAMBDA = 0.8f;
+
+/// casters this far behind a cascade (toward the light) still cast into it
+const float CASTER_DISTANCE = 20.f;
+
+/// cached cascades cover this much more than they need
+const float CACHE_PADDING = 1.25f;
+
+}
+
+//----------------------------------------------------------------------------
+void ShadowUniforms::find(GLuint program_id)
+{
+	matrices = glGetUniformLocation(program_id, "shadow_matrices");
+	splits = glGetUniformLocation(program_id, "cascade_splits");
+	enabled = glGetUniformLocation(program_id, "shadows_enabled");
+	map = glGetUniformLocation(program_id, "shadow_map");
+}
+
+//----------------------------------------------------------------------------
+CascadedShadows::~CascadedShadows()
+{
+	glDeleteFramebuffers(1, &framebuffer_);
+	glDeleteTextures(1, &depth_texture_);
+	if (resources_)
+	{
+		resources_->unreserve(gpu_bytes_);
+		resources_->release(depth_program_);
+	}
+}
+
+bool CascadedShadows::init(ResidencyManager &resources)
+{
+	resources_ = &resources;
+	depth_program_ = resources.acquireProgram("../shadowDepth.vert.glsl", "../shadowDepth.frag.glsl");
+	if (!depth_program_)
+		return false;
+	depth_mvp_id_ = glGetUniformLocation(depth_program_->id, "MVP");
+
+	// one depth layer per cascade, compared in the sampler
+	glGenTextures(1, &depth_texture_);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depth_texture_);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, SIZE, SIZE, NUM_CASCADES,
+	    0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	gpu_bytes_ = std::size_t(SIZE) * SIZE * NUM_CASCADES * 4;
+	resources.reserve(gpu_bytes_);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	const float border[] = {1.f, 1.f, 1.f, 1.f};
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	glGenFramebuffers(1, &framebuffer_);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture_, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	const GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "Shadow framebuffer incomplete: " << status << std::endl;
+		return false;
+	}
+
+	invalidate();
+	return true;
+}
+
+void CascadedShadows::setLightDirection(const glm::vec3 &dir)
+{
+	if (dir == light_dir_)
+		return;
+
+	light_dir_ = dir;
+	invalidate();
+}
+
+void CascadedShadows::invalidate()
+{
+	for (auto &v : valid_)
+		v = false;
+}
+
+void CascadedShadows::update(const Controls &controls)
+{
+	const float near_plane = Controls::NEAR_PLANE;
+	// a copy, std::min's reference would need FAR_PLANE defined before C++17
+	const float view_far = Controls::FAR_PLANE;
+	const float far_plane = std::min(view_far, SHADOW_DISTANCE);
+	const float tan_half_fov = std::tan(glm::radians(controls.fieldOfView()) * 0.5f);
+	const glm::mat4 inv_view = glm::inverse(controls.viewMatrix());
+
+	float slice_near = near_plane;
+	for (unsigned i = 0; i < NUM_CASCADES; ++i)
+	{
+		const float t = float(i + 1) / NUM_CASCADES;
+		const float log_split = near_plane * std::pow(far_plane / near_plane, t);
+		const float even_split = near_plane + (far_plane - near_plane) * t;
+		const float slice_far = SPLIT_LAMBDA * log_split + (1.f - SPLIT_LAMBDA) * even_split;
+		splits_[i] = slice_far;
+
+		// corners of the slice, in world space
+		glm::vec3 corners[8];
+		unsigned c = 0;
+		for (const float d : {slice_near, slice_far})
+		{
+			const float h = d * tan_half_fov;
+			const float w = h * Controls::ASPECT_RATIO;
+			for (const float x : {-w, w})
+			{
+				for (const float y : {-h, h})
+					corners[c++] = glm::vec3(inv_view * glm::vec4(x, y, -d, 1.f));
+			}
+		}
+		slice_near = slice_far;
+
+		// bounding sphere (the radius only depends on the split, so it is stable)
+		glm::vec3 center(0.f);
+		for (const auto &p : corners)
+			center += p;
+		center *= 1.f / 8;
+
+		float radius = 0;
+		for (const auto &p : corners)
+			radius = std::max(radius, glm::length(p - center));
+		radius = std::ceil(radius * 16.f) / 16.f;
+
+		if (i < FIRST_CACHED)
+		{
+			place(i, center, radius);
+			dirty_[i] = true;
+			continue;
+		}
+
+		// cached: render again only if the slice left the covered area
+		const bool covered = valid_[i] &&
+		    glm::length(center - center_[i]) + radius <= radius_[i];
+		dirty_[i] = !covered;
+		if (!covered)
+			place(i, center, radius * CACHE_PADDING);
+	}
+}
+
+void CascadedShadows::place(unsigned cascade, const glm::vec3 &center, float radius)
+{
+	const glm::vec3 up = std::abs(light_dir_.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+	const glm::mat4 view = glm::lookAt(center - light_dir_ * (radius + CASTER_DISTANCE), center, up);
+	glm::mat4 proj = glm::ortho(-radius, radius, -radius, radius, 0.f, 2 * radius + CASTER_DISTANCE);
+
+	// snap to whole texels, so edges don't shimmer as the camera moves
+	const glm::vec4 origin = proj * view * glm::vec4(0, 0, 0, 1);
+	const float half_size = SIZE * 0.5f;
+	const float x = origin.x * half_size;
+	const float y = origin.y * half_size;
+	proj[3][0] += (std::floor(x + 0.5f) - x) / half_size;
+	proj[3][1] += (std::floor(y + 0.5f) - y) / half_size;
+
+	light_vp_[cascade] = proj * view;
+	light_frustum_[cascade] = extractFrustum(light_vp_[cascade]);
+	center_[cascade] = center;
+	radius_[cascade] = radius;
+}
+
+void CascadedShadows::beginCascade(unsigned cascade)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_texture_, 0, cascade);
+	glViewport(0, 0, SIZE, SIZE);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	// slope scaled bias against acne
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.f, 4.f);
+
+	glUseProgram(depth_program_->id);
+
+	valid_[cascade] = true;
+	++renders_[cascade];
+}
+
+void CascadedShadows::endCascades(int width, int height)
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+}
+
+void CascadedShadows::apply(const CascadedShadows *shadows, const ShadowUniforms &uniforms)
+{
+	// the shadow sampler can't share unit 0 with the 2D texture, even when unused
+	glUniform1i(uniforms.map, 1);
+	if (!shadows)
+	{
+		glUniform1i(uniforms.enabled, 0);
+		return;
+	}
+	static_assert(NUM_CASCADES <= 4, "splits are a vec4");
+
+	// clip space to texture space
+	const glm::mat4 bias(
+	    0.5f, 0.0f, 0.0f, 0.0f,
+	    0.0f, 0.5f, 0.0f, 0.0f,
+	    0.0f, 0.0f, 0.5f, 0.0f,
+	    0.5f, 0.5f, 0.5f, 1.0f);
+
+	glm::mat4 matrices[NUM_CASCADES];
+	float splits[4] = {1e30f, 1e30f, 1e30f, 1e30f};
+	for (unsigned i = 0; i < NUM_CASCADES; ++i)
+	{
+		matrices[i] = bias * shadows->light_vp_[i];
+		splits[i] = shadows->splits_[i];
+	}
+
+	glUniform1i(uniforms.enabled, 1);
+	glUniformMatrix4fv(uniforms.matrices, NUM_CASCADES, GL_FALSE, &matrices[0][0][0]);
+	glUniform4fv(uniforms.splits, 1, splits);
+
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadows->depth_texture_);
+	glActiveTexture(GL_TEXTURE0);
+}
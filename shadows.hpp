@@ -0,0 +1,85 @@
+#pragma once
+
+#include "frustum.hpp"
+#include "shadowUniforms.hpp"
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+
+class Controls;
+class ResidencyManager;
+struct Program;
+
+//----------------------------------------------------------------------------
+/// Cascaded shadow maps for the main directional light
+/// The view frustum is split into NUM_CASCADES slices by distance, each with
+/// its own layer of a depth texture array. Cascades from FIRST_CACHED on only
+/// hold static geometry: they cover a bit more than they need to, and are only
+/// rendered again when the camera leaves that area, the light moves, or the
+/// static geometry changes (invalidate).
+class CascadedShadows
+{
+public:
+	static constexpr unsigned NUM_CASCADES = 3; ///< must match standardShading.frag.glsl
+	static constexpr unsigned FIRST_CACHED = 1; ///< cascades from here are cached
+	static constexpr GLsizei SIZE = 2048; ///< texels per side
+
+	CascadedShadows() = default;
+	CascadedShadows(const CascadedShadows&) = delete;
+	CascadedShadows& operator=(const CascadedShadows&) = delete;
+	~CascadedShadows();
+
+	bool init(ResidencyManager &resources);
+
+	/// direction the light shines (normalized)
+	void setLightDirection(const glm::vec3 &dir);
+	const glm::vec3& lightDirection() const { return light_dir_; }
+
+	/// static geometry changed, render all cascades again
+	void invalidate();
+
+	/// place the cascades around the camera, and decide which need rendering
+	void update(const Controls &controls);
+
+	bool needsRender(unsigned cascade) const { return dirty_[cascade]; }
+
+	/// bind the depth target and program for a cascade
+	void beginCascade(unsigned cascade);
+	/// back to the window framebuffer
+	void endCascades(int width, int height);
+
+	const glm::mat4& lightMatrix(unsigned cascade) const { return light_vp_[cascade]; }
+	const Frustum& lightFrustum(unsigned cascade) const { return light_frustum_[cascade]; }
+
+	/// MVP uniform of the depth program (bound by beginCascade)
+	GLint depthMvpId() const { return depth_mvp_id_; }
+
+	/// set the shading program's shadow uniforms (shadows can be null)
+	static void apply(const CascadedShadows *shadows, const ShadowUniforms &uniforms);
+
+	/// cascades rendered since init (cached ones count when they are redrawn)
+	unsigned renders(unsigned cascade) const { return renders_[cascade]; }
+
+private:
+	void place(unsigned cascade, const glm::vec3 &center, float radius);
+
+private:
+	ResidencyManager *resources_ = nullptr;
+	Program *depth_program_ = nullptr; ///< (shared)
+	GLint depth_mvp_id_ = -1;
+
+	GLuint depth_texture_ = 0; ///< one layer per cascade
+	GLuint framebuffer_ = 0;
+	std::size_t gpu_bytes_ = 0; ///< of the depth texture (reserved with the residency manager)
+
+	glm::vec3 light_dir_ = glm::vec3(0.f, -1.f, 0.f);
+
+	float splits_[NUM_CASCADES] = {}; ///< far distance of each cascade (view space)
+	glm::mat4 light_vp_[NUM_CASCADES]; ///< world to light clip space
+	Frustum light_frustum_[NUM_CASCADES];
+	glm::vec3 center_[NUM_CASCADES]; ///< of the area covered
+	float radius_[NUM_CASCADES] = {}; ///< of the area covered
+	bool valid_[NUM_CASCADES] = {}; ///< has been rendered
+	bool dirty_[NUM_CASCADES] = {}; ///< render this frame
+	unsigned renders_[NUM_CASCADES] = {};
+};
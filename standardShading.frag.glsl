@@ -6,6 +6,7 @@ in vec3 Position_worldspace;
 in vec3 Normal_cameraspace;
 in vec3 EyeDirection_cameraspace;
 in vec3 LightDirection_cameraspace;
+in float Depth_cameraspace;
 
 // Ouput data
 out vec3 color;
@@ -13,23 +14,41 @@ out vec3 color;
 // Values that stay constant for the whole mesh.
 uniform sampler2D myTextureSampler;
 uniform mat4 MV;
-uniform vec3 LightPosition_worldspace;
+
+// cascaded shadow maps (CascadedShadows::NUM_CASCADES)
+const int NUM_CASCADES = 3;
+uniform sampler2DArrayShadow shadow_map;
+uniform mat4 shadow_matrices[NUM_CASCADES]; // world to shadow texture space
+uniform vec4 cascade_splits; // far distance of each cascade
+uniform int shadows_enabled;
+
+// how much of the light reaches this fragment
+float shadowVisibility()
+{
+	if (shadows_enabled == 0 || Depth_cameraspace > cascade_splits[NUM_CASCADES - 1])
+		return 1.0;
+
+	int cascade = 0;
+	while (cascade < NUM_CASCADES - 1 && Depth_cameraspace > cascade_splits[cascade])
+		++cascade;
+
+	// linear filtering compares the 4 nearest texels (2x2 PCF)
+	vec4 p = shadow_matrices[cascade] * vec4(Position_worldspace, 1);
+	return texture(shadow_map, vec4(p.xy, float(cascade), p.z - 0.0005));
+}
 
 void main()
 {
 	// Light emission properties
 	// You probably want to put them as uniforms
 	vec3 LightColor = vec3(1, 1, 1);
-	float LightPower = 50.0f;
+	float LightPower = 1.0f; // directional, so no falloff with distance
 
 	// Material properties
 	vec3 MaterialDiffuseColor = texture(myTextureSampler, UV).rgb;
 	vec3 MaterialAmbientColor = vec3(0.1, 0.1, 0.1) * MaterialDiffuseColor;
 	vec3 MaterialSpecularColor = vec3(0.3, 0.3, 0.3);
 
-	// Distance to the light
-	float distance = length(LightPosition_worldspace - Position_worldspace);
-
 	// Normal of the computed fragment, in camera space
 	vec3 n = normalize(Normal_cameraspace);
 
@@ -55,12 +74,15 @@ void main()
 	//  - Looking elsewhere -> < 1
 	float cosAlpha = clamp( dot( E,R ), 0,1 );
 
+	// Shadow: no diffuse or specular where the light is blocked
+	float visibility = shadowVisibility();
+
 	color = 
 		// Ambient: simulates indirect lighting
 		MaterialAmbientColor +
 		// Diffuse: "color" of the object
-		MaterialDiffuseColor * LightColor * LightPower * cosTheta / (distance*distance) +
+		visibility * MaterialDiffuseColor * LightColor * LightPower * cosTheta +
 		// Specular: reflective highlight, like a mirror
-		MaterialSpecularColor * LightColor * LightPower * pow(cosAlpha,5) / (distance*distance);
+		visibility * MaterialSpecularColor * LightColor * LightPower * pow(cosAlpha,5);
 }
 
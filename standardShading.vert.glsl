@@ -11,12 +11,13 @@ out vec3 Position_worldspace;
 out vec3 Normal_cameraspace;
 out vec3 EyeDirection_cameraspace;
 out vec3 LightDirection_cameraspace;
+out float Depth_cameraspace; // distance in front of the camera
 
 // Values that stay constant for the whole mesh.
 uniform mat4 MVP;
 uniform mat4 V;
 uniform mat4 M;
-uniform vec3 LightPosition_worldspace;
+uniform vec3 LightDirection_worldspace; // the direction the light shines
 
 void main()
 {
@@ -30,10 +31,11 @@ void main()
 	// In camera space, the camera is at the origin (0,0,0).
 	vec3 vertexPosition_cameraspace = (V * M * vec4(vertexPosition_modelspace, 1)).xyz;
 	EyeDirection_cameraspace = vec3(0, 0, 0) - vertexPosition_cameraspace;
+	Depth_cameraspace = -vertexPosition_cameraspace.z;
 
-	// Vector that goes from the vertex to the light, in camera space. M is ommited because it's identity.
-	vec3 LightPosition_cameraspace = (V * vec4(LightPosition_worldspace, 1)).xyz;
-	LightDirection_cameraspace = LightPosition_cameraspace + EyeDirection_cameraspace;
+	// Vector that goes from the vertex to the light, in camera space.
+	// The light is directional, so it is the same for every vertex.
+	LightDirection_cameraspace = (V * vec4(-LightDirection_worldspace, 0)).xyz;
 
 	// Normal of the the vertex, in camera space
 	// Only correct if ModelMatrix does not scale the model! Use its inverse transpose if not.